@@ -0,0 +1,192 @@
+#include <board.h>
+#include <alphabeta.h>
+#include <benchmark/benchmark.h>
+
+
+static const char *positions[] = {
+	"default1.txt",
+	"analysis1.txt",
+	"endgame1.txt",
+	"endgame2.txt"
+};
+
+#define NUM_POSITIONS (sizeof(positions) / sizeof(positions[0]))
+
+/* Description: loads the shipped position selected by the benchmark argument into b and
+ * 		labels the benchmark with its name.
+ */
+static bool load_position(benchmark::State &state, Board &b)
+{
+	std::string file_name = std::string{FF_POSITIONS_DIR} + positions[state.range(0)];
+	if (!b.load_file(file_name)) {
+		state.SkipWithError("Couldn't load the position");
+		return false;
+	}
+	state.SetLabel(positions[state.range(0)]);
+	return true;
+}
+
+/* Description: loads the position like load_position and moves it into the given state by
+ * 		applying the first legal move if needed.
+ */
+static bool load_position_in(benchmark::State &state, Board &b, Turn_T phase)
+{
+	if (!load_position(state, b)) {
+		return false;
+	}
+	if (b.state != phase) {
+		if (b.state == SWAP) {
+			auto swaps = b.generate_swaps();
+			if (swaps.empty()) {
+				state.SkipWithError("No swaps available");
+				return false;
+			}
+			b.apply_swap(swaps[0].first, swaps[0].second);
+		} else {
+			b.apply_action(action{BOARD_SIZE, 0});
+		}
+	}
+	return true;
+}
+
+static void BM_GenerateSwaps(benchmark::State &state)
+{
+	Board b;
+	if (!load_position_in(state, b, SWAP)) {
+		return;
+	}
+	SwapList swaps;
+
+	for (auto _ : state) {
+		b.generate_swaps(swaps);
+		benchmark::DoNotOptimize(swaps);
+	}
+}
+
+static void BM_GenerateActions(benchmark::State &state)
+{
+	Board b;
+	if (!load_position_in(state, b, ACTION)) {
+		return;
+	}
+	ActionList actions;
+
+	for (auto _ : state) {
+		b.generate_actions(actions);
+		benchmark::DoNotOptimize(actions);
+	}
+}
+
+static void BM_ApplySwap(benchmark::State &state)
+{
+	Board b;
+	if (!load_position_in(state, b, SWAP)) {
+		return;
+	}
+	SwapList swaps;
+	b.generate_swaps(swaps);
+	if (swaps.empty()) {
+		state.SkipWithError("No swaps available");
+		return;
+	}
+	size_t i = 0;
+
+	for (auto _ : state) {
+		Board child{b};
+		auto &swap = swaps[i++ % swaps.size()];
+		child.apply_swap(swap.first, swap.second);
+		benchmark::DoNotOptimize(child);
+	}
+}
+
+static void BM_ApplyAction(benchmark::State &state)
+{
+	Board b;
+	if (!load_position_in(state, b, ACTION)) {
+		return;
+	}
+	ActionList actions;
+	b.generate_actions(actions);
+	size_t i = 0;
+
+	for (auto _ : state) {
+		Board child{b};
+		child.apply_action(actions[i++ % actions.size()]);
+		benchmark::DoNotOptimize(child);
+	}
+}
+
+static void BM_UpdateAllActivity(benchmark::State &state)
+{
+	Board b;
+	if (!load_position(state, b)) {
+		return;
+	}
+
+	for (auto _ : state) {
+		b.update_all_activity();
+		benchmark::DoNotOptimize(b);
+	}
+}
+
+static void BM_Hash(benchmark::State &state)
+{
+	Board b;
+	if (!load_position(state, b)) {
+		return;
+	}
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(b.hash());
+	}
+}
+
+static void BM_LoadHash(benchmark::State &state)
+{
+	Board b;
+	if (!load_position(state, b)) {
+		return;
+	}
+	const uint_fast128_t packed = b.hash();
+
+	for (auto _ : state) {
+		Board loaded;
+		benchmark::DoNotOptimize(loaded.load_hash(packed));
+	}
+}
+
+static void BM_Winner(benchmark::State &state)
+{
+	Board b;
+	if (!load_position(state, b)) {
+		return;
+	}
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(b.winner());
+	}
+}
+
+static void BM_Heuristic(benchmark::State &state)
+{
+	Board b;
+	if (!load_position(state, b)) {
+		return;
+	}
+
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(heuristic(b));
+	}
+}
+
+BENCHMARK(BM_GenerateSwaps)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_GenerateActions)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_ApplySwap)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_ApplyAction)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_UpdateAllActivity)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_Hash)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_LoadHash)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_Winner)->DenseRange(0, NUM_POSITIONS - 1);
+BENCHMARK(BM_Heuristic)->DenseRange(0, NUM_POSITIONS - 1);
+
+BENCHMARK_MAIN();
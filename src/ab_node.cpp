@@ -1,44 +1,61 @@
 #include "ab_node.h"
 
 
-AB_Node::AB_Node(Board cpy, int index): move_index{index}, value{0}, state{cpy}
+AB_Node::AB_Node(int index): move_index{index}, value{0}, children{nullptr}, num_children{0}
 {
 }
 
-AB_Node::~AB_Node()
+bool AB_Node::is_leaf(Board &state)
 {
-	for (auto child : this->children) {
-		delete child;
-	}
-}
-
-bool AB_Node::is_leaf()
-{
-	return this->state.gameover();
+	return state.gameover();
 }
 
-void AB_Node::expand()
+template <Turn_T S, Team T>
+void AB_Node::expand(Board &state, Arena &arena)
 {
 	// check if the node has previously been expanded
-	if (this->children.size()) {
+	if (this->num_children) {
 		return;
 	}
-	AB_Node *copy;
-	int counter = 0;
 
-	if (this->state.state == SWAP) {
-		auto swaps = this->state.generate_swaps();
+	if constexpr (S == SWAP) {
+		SwapList swaps;
+		state.generate_swaps_for<T>(swaps);
+		this->children = arena.construct<AB_Node>(swaps.size());
 		for (auto &swap : swaps) {
-			copy = new AB_Node(Board(this->state), counter++);
-			copy->state.apply_swap(swap.first, swap.second);
-			this->children.emplace_back(copy);
+			AB_Node &child = this->children[this->num_children];
+			child.move_index = this->num_children++;
+			child.move.swap.first = swap.first;
+			child.move.swap.second = swap.second;
 		}
 	} else {
-		auto actions = this->state.generate_actions();
+		ActionList actions;
+		state.generate_actions_for<T>(actions);
+		this->children = arena.construct<AB_Node>(actions.size());
 		for (auto &act : actions) {
-			copy = new AB_Node(Board(this->state), counter++);
-			copy->state.apply_action(act);
-			this->children.emplace_back(copy);
+			AB_Node &child = this->children[this->num_children];
+			child.move_index = this->num_children++;
+			child.move.act = act;
 		}
 	}
 }
+
+void AB_Node::expand(Board &state, Arena &arena)
+{
+	if (state.state == SWAP) {
+		if (state.to_play == BLACK) {
+			expand<SWAP, BLACK>(state, arena);
+		} else {
+			expand<SWAP, WHITE>(state, arena);
+		}
+	} else if (state.to_play == BLACK) {
+		expand<ACTION, BLACK>(state, arena);
+	} else {
+		expand<ACTION, WHITE>(state, arena);
+	}
+}
+
+template void AB_Node::expand<SWAP, BLACK>(Board &state, Arena &arena);
+template void AB_Node::expand<SWAP, WHITE>(Board &state, Arena &arena);
+template void AB_Node::expand<ACTION, BLACK>(Board &state, Arena &arena);
+template void AB_Node::expand<ACTION, WHITE>(Board &state, Arena &arena);
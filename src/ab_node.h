@@ -1,24 +1,35 @@
 #pragma once
 
 #include "board.h"
+#include "arena.h"
 
 
 struct AB_Node {
 	int move_index; // index of move used to get to this node
 	float value;
-	Board state;
-	std::vector<AB_Node *> children;
+	MoveChoice move; // move used to get to this node
+	// children are stored contiguously in the arena used to expand the node
+	AB_Node *children;
+	int num_children;
 
-	AB_Node(Board state, int index = -1);
-
-	~AB_Node();
+	AB_Node(int index = -1);
 	/* Description: returns true if the node is a leaf (gameover state).
-	 * Args: None
+	 * Args: state - the board state of this node.
 	 */
-	bool is_leaf();
-	/* Description: populates the children vector with the states that can be reached
+	bool is_leaf(Board &state);
+	/* Description: populates the children array with the moves that can be made
 	 * 		from the current state.
-	 * Args: None
+	 * Args: state - the board state of this node.
+	 * 	 arena - the arena to allocate the children from.
+	 */
+	void expand(Board &state, Arena &arena);
+	/* Description: expand for a node whose state is S with team T to play.
+	 * Args: state - the board state of this node.
+	 * 	 arena - the arena to allocate the children from.
 	 */
-	void expand();
+	template <Turn_T S, Team T>
+	void expand(Board &state, Arena &arena);
+
+	AB_Node *begin() { return this->children; }
+	AB_Node *end() { return this->children + this->num_children; }
 };
@@ -1,95 +1,1097 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
 #include "alphabeta.h"
+#include "thread_pool.h"
+#include "transposition.h"
 
+// nodes shallower than this search their children serially in the deterministic search,
+// their subtrees are too small to be worth handing to another thread
+#define YBW_MIN_SPLIT_DEPTH 2
+// depth of the deterministic search when suggest_move is asked for depth 0, it ignores the limits
+// that would stop it otherwise
+#define YBW_DEFAULT_DEPTH 4
+// plies that keep killer moves, deeper nodes are ordered without them
+#define MAX_PLY 64
+#define NUM_KILLERS 2
+// half width of the first aspiration window around the previous iteration's score, the score
+// often moves by a point between iterations. The window grows by ASPIRATION_GROWTH on each
+// failure and is dropped once it reaches ASPIRATION_MAX
+#define ASPIRATION_WINDOW 2.0f
+#define ASPIRATION_GROWTH 4
+#define ASPIRATION_MAX 32
+// quiet moves searched after the first LMR_MIN_MOVES children of a node at least LMR_MIN_DEPTH
+// from the horizon are first searched LMR_REDUCTION plies shallower
+#define LMR_MIN_MOVES 6
+#define LMR_MIN_DEPTH 4
+#define LMR_REDUCTION 2
+// the skip action is searched NULL_MOVE_REDUCTION plies shallower than the other moves to
+// prove a cutoff at nodes at least NULL_MOVE_MIN_DEPTH from the horizon
+#define NULL_MOVE_MIN_DEPTH 3
+#define NULL_MOVE_REDUCTION 2
+// nodes visited between reads of the clock by a search with a time limit, must be a power of two
+#define CLOCK_CHECK_INTERVAL 1024
+// upper bound on the children of a node
+#define MAX_CHILDREN (MAX_ACTIONS(BOARD_WIDTH, BOARD_HEIGHT) > MAX_SWAPS(BOARD_WIDTH, BOARD_HEIGHT) \
+		? MAX_ACTIONS(BOARD_WIDTH, BOARD_HEIGHT) : MAX_SWAPS(BOARD_WIDTH, BOARD_HEIGHT))
+static_assert(MAX_CHILDREN <= 256, "the order of the children is stored in uint_fast8_t");
+// x is only compiled in builds that count the statistics of the search
+#ifdef FF_SEARCH_STATS
+#	define SEARCH_STAT(x) x
+#else
+#	define SEARCH_STAT(x)
+#endif
 
-float heuristic(AB_Node *node)
+
+// shared by every search thread
+static TranspositionTable tt;
+// nodes of the search tree, released once the search is over
+static Arena arena;
+// helper threads build their own trees, the arenas are kept between searches
+static std::vector<Arena> helper_arenas;
+// background search started by start_pondering and the flag that stops it
+static std::thread ponder_thread;
+static std::atomic<bool> ponder_stop;
+// runs the deterministic search, each worker allocates its nodes from its own arena
+static ThreadPool pool;
+static std::vector<Arena> worker_arenas;
+
+/*
+ * State of one thread's search.
+ */
+struct SearchContext {
+	Arena &arena;
+	// set by another thread to stop the search, the main thread when its search is done for the
+	// helpers and the caller of suggest_move for the main thread, can be nullptr
+	const std::atomic<bool> *stop;
+	// true once the search was stopped, values computed after this are not reliable
+	bool aborted = false;
+	// the pruning enabled by the search options
+	bool reductions;
+	bool null_move;
+	bool quiescence;
+	// index of the best root move of the last iteration that searched the root's children
+	int root_move = TT_NO_MOVE;
+	// the last moves that caused a cutoff at each ply, most recent first, zeroed slots
+	// match no legal move
+	MoveChoice killers[MAX_PLY][NUM_KILLERS] = {};
+	// depth squared summed over the cutoffs caused by each move of each team, swaps are
+	// indexed by their positions and actions by the actor and their two lowest targets
+	// (BOARD_SIZE if there are fewer targets)
+	uint32_t swap_history[NUM_TEAMS][BOARD_SIZE][BOARD_SIZE] = {};
+	uint32_t action_history[NUM_TEAMS][BOARD_SIZE + 1][BOARD_SIZE + 1][BOARD_SIZE + 1] = {};
+	// nodes visited by this thread
+	uint64_t nodes = 0;
+	// the search stops after visiting node_limit nodes or at the deadline, 0 for no node limit
+	uint64_t node_limit = 0;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+	// the statistics counted by the main thread, nullptr for the helpers
+	SearchStats *stats = nullptr;
+	// the limits only apply once the search has a move to return if they stop it
+	bool limited = false;
+
+	/* Description: starts a search without limits.
+	 * Args: arena - the arena to allocate the thread's tree from.
+	 * 	 stop - the flag that stops the search, can be nullptr.
+	 * 	 options - the pruning to use.
+	 */
+	SearchContext(Arena &arena, const std::atomic<bool> *stop, const SearchOptions &options):
+		arena{arena}, stop{stop}, reductions{options.late_move_reductions}, null_move{options.null_move},
+		quiescence{options.quiescence}
+	{
+	}
+};
+
+
+float heuristic(Board &state)
 {
-	float value = 0, points;
-	std::pair<Team, Win_Condition> winner_info = node->state.winner();
-	static const float multipliers[NUM_PIECES] = {1.0, 0.9, 0.6, 0.7, 0.7, 0.65};
+	float value = 0;
+	std::pair<Team, Win_Condition> winner_info = state.winner();
 
 	if (winner_info.first == BLACK) {
 		value = std::numeric_limits<float>::infinity();
 	} else if (winner_info.first == WHITE) {
 		value = -std::numeric_limits<float>::infinity();
 	} else if (winner_info.second == NO_WINNER) {
-		value = 0;
-		auto tiles = node->state.tile_info();
-		for (int pos = 0; pos < BOARD_SIZE; ++pos) {
-			auto &tile = tiles[pos];
-			if (tile.hp <= 0) {
-				continue;
-			}
-			points = (tile.active ? 1.5 * tile.hp : tile.hp) + node->state.num_friendly_neighbours(pos) * 0.5;
-			value += multipliers[tile.type] * points * (tile.team == BLACK ? 1 : -1);
-		}
+		// the board keeps the sum over its pieces of multiplier * points, where points is
+		// (active ? 1.5 * hp : hp) + 0.5 * friendly neighbours
+		value = (float)state.eval() / EVAL_SCALE;
 	}
 
 	return value;
 }
 
 
-float alphabeta(AB_Node *node, int depth, float alpha, float beta, Team maximizing)
+/* Description: counts a node against the limits of the search, returns true once they are
+ * 		reached. The limits only apply once the search has a move to fall back on.
+ * Args: ctx - the search to check.
+ */
+static bool out_of_budget(SearchContext &ctx)
 {
-	if (depth <= 0 or node->is_leaf()) {
-		node->value = heuristic(node) * (maximizing == BLACK ? 1 : -1);
-		return node->value;
+	++ctx.nodes;
+	if (!ctx.limited) {
+		return false;
+	}
+	if (ctx.node_limit && ctx.nodes >= ctx.node_limit) {
+		return true;
+	}
+	// reading the clock costs more than a node, only do it every so often
+	return ctx.deadline != std::chrono::steady_clock::time_point::max()
+		&& (ctx.nodes & (CLOCK_CHECK_INTERVAL - 1)) == 0
+		&& std::chrono::steady_clock::now() >= ctx.deadline;
+}
+
+/* Description: returns true if a and b are the same move of a board in state S.
+ * Args: a - the first move.
+ * 	 b - the second move.
+ */
+template <Turn_T S>
+static bool same_move(const MoveChoice &a, const MoveChoice &b)
+{
+	if constexpr (S == SWAP) {
+		return a.swap.first == b.swap.first && a.swap.second == b.swap.second;
+	} else {
+		return a.act.pos == b.act.pos && a.act.trgts == b.act.trgts;
 	}
+}
 
-	float val;
-	node->expand();
+/* Description: returns the history entry of move m of a board in state S with team T to play.
+ * Args: ctx - the search holding the history.
+ * 	 m - the move to look up.
+ */
+template <Turn_T S, Team T>
+static uint32_t &history(SearchContext &ctx, const MoveChoice &m)
+{
+	if constexpr (S == SWAP) {
+		return ctx.swap_history[T][m.swap.first][m.swap.second];
+	} else {
+		uint_fast16_t trgts = m.act.trgts;
+		const int first = trgts ? __builtin_ctz(trgts) : BOARD_SIZE;
+		trgts &= trgts - 1;
+		const int second = trgts ? __builtin_ctz(trgts) : BOARD_SIZE;
+		return ctx.action_history[T][m.act.pos][first][second];
+	}
+}
 
-	if (node->state.to_play == maximizing) {
-		// sort children based on most promising from previous searches, in this case from greatest to smallest value
-		std::sort(node->children.begin(), node->children.end(), [](AB_Node *a, AB_Node *b) { return a->value > b->value; });
+/* Description: records that m caused a cutoff at ply, making it the first killer of the ply
+ * 		and crediting its history.
+ * Args: ctx - the search to update.
+ * 	 m - the move that caused the cutoff.
+ * 	 depth - the remaining depth of the node the cutoff happened at.
+ * 	 ply - the distance of the node from the root.
+ */
+template <Turn_T S, Team T>
+static void record_cutoff(SearchContext &ctx, const MoveChoice &m, int depth, int ply)
+{
+	history<S, T>(ctx, m) += depth * depth;
+	if (ply >= MAX_PLY) {
+		return;
+	}
+	MoveChoice *killers = ctx.killers[ply];
+	if (!same_move<S>(killers[0], m)) {
+		for (int i = NUM_KILLERS - 1; i > 0; --i) {
+			killers[i] = killers[i - 1];
+		}
+		killers[0] = m;
+	}
+}
 
-		val = -std::numeric_limits<float>::infinity();
-		for (auto &child : node->children) {
-			val = std::max(val, alphabeta(child, depth - 1, alpha, beta, maximizing));
-			alpha = std::max(alpha, val);
-			if (alpha >= beta)
+/* Description: quiescence search of a position at the horizon with team T to act, returns
+ * 		its score from the point of view of T. Only actions that kill an enemy piece or
+ * 		save a friendly one are searched, T can also stand pat on the static evaluation.
+ * 		The swap that follows is not searched, so the positions after the actions stand
+ * 		pat too and no nodes are added to the tree.
+ * Args: state - the board state to search.
+ * 	 alpha - the lower bound of the window.
+ * 	 beta - the upper bound of the window.
+ * 	 ctx - the state of the thread's search, only used to count the statistics.
+ */
+template <Team T>
+static float quiesce(Board &state, float alpha, float beta, [[maybe_unused]] SearchContext &ctx)
+{
+	float val = heuristic(state) * (T == BLACK ? 1 : -1);
+	if (val >= beta) {
+		return val;
+	}
+	alpha = std::max(alpha, val);
+
+	ActionList actions;
+	state.generate_actions_for<T>(actions);
+	for (auto &act : actions) {
+		if (!state.kills(act) && !state.saves(act)) {
+			continue;
+		}
+		SEARCH_STAT(if (ctx.stats) ++ctx.stats->quiescence_moves;)
+		MoveChoice m;
+		m.act = act;
+		const undo u = state.make_move_for<ACTION, T>(m);
+		const float score = heuristic(state) * (T == BLACK ? 1 : -1);
+		state.unmake_for<ACTION, T>(u);
+		if (score > val) {
+			val = score;
+			if (val >= beta) {
 				break;
+			}
 		}
-		node->value = val;
+	}
+
+	return val;
+}
+
+/* Description: principal variation search of node, a position in state S with team T to play.
+ * 		Scores are negamax scores, from the point of view of the team to play, and are
+ * 		only negated between plies where the team to play changes. The state and team of
+ * 		the children are known from S and T, so the whole search is specialised once at
+ * 		the root.
+ * Args: node - the node to search.
+ * 	 state - the board state of node.
+ * 	 depth - the remaining depth to search.
+ * 	 alpha - the lower bound of the window.
+ * 	 beta - the upper bound of the window.
+ * 	 ctx - the state of the thread's search.
+ * 	 ply - the distance from the root.
+ * 	 null_ok - false if the null move must not be tried at this node.
+ */
+template <Turn_T S, Team T>
+static float alphabeta(AB_Node *node, Board &state, int depth, float alpha, float beta, SearchContext &ctx, int ply,
+		bool null_ok = true)
+{
+	// the state and team to play after a move from this node
+	constexpr Turn_T next_state = S == SWAP ? ACTION : SWAP;
+	constexpr Team next_team = S == SWAP ? T : static_cast<Team>(1 - T);
+	assert(state.state == S && state.to_play == T);
+
+	if ((ctx.stop && ctx.stop->load(std::memory_order_relaxed)) || out_of_budget(ctx)) {
+		ctx.aborted = true;
+		return 0;
+	}
+	if (node->is_leaf(state)) {
+		SEARCH_STAT(if (ctx.stats) ++ctx.stats->leaves;)
+		node->value = heuristic(state) * (T == BLACK ? 1 : -1);
+		return node->value;
+	}
+	if (depth <= 0) {
+		SEARCH_STAT(if (ctx.stats) ++ctx.stats->leaves;)
+		if constexpr (S == ACTION) {
+			node->value = ctx.quiescence ? quiesce<T>(state, alpha, beta, ctx) : heuristic(state) * (T == BLACK ? 1 : -1);
+		} else {
+			node->value = heuristic(state) * (T == BLACK ? 1 : -1);
+		}
+		return node->value;
+	}
+
+	const uint64_t key = state.key();
+	const float alpha_orig = alpha;
+	int tt_move = TT_NO_MOVE;
+	tt_entry entry;
+
+	SEARCH_STAT(if (ctx.stats) ++ctx.stats->tt_probes;)
+	if (tt.probe(key, entry)) {
+		SEARCH_STAT(if (ctx.stats) ++ctx.stats->tt_hits;)
+		tt_move = entry.move;
+		// never cut at the root, the best root move is needed
+		if (ply > 0 && entry.depth >= depth) {
+			if (entry.bound == EXACT
+					|| (entry.bound == LOWER_BOUND && entry.score >= beta)
+					|| (entry.bound == UPPER_BOUND && entry.score <= alpha)) {
+				SEARCH_STAT(if (ctx.stats) ++ctx.stats->tt_cutoffs;)
+				node->value = entry.score;
+				return entry.score;
+			}
+		}
+	}
+
+	// children of a node searched in an earlier iteration are ordered by the values they got,
+	// the children of a new node only have the history of their moves
+	const bool searched = node->num_children != 0;
+	node->expand<S, T>(state, ctx.arena);
+	SEARCH_STAT(if (ctx.stats && !searched) {
+		++ctx.stats->expanded;
+		ctx.stats->children += node->num_children;
+	})
+
+	// searches child to depth d with the window (lo, hi) from this node's point of view
+	auto search = [&](AB_Node &child, int d, float lo, float hi) {
+		if constexpr (next_team == T) {
+			return alphabeta<next_state, next_team>(&child, state, d, lo, hi, ctx, ply + 1);
+		} else {
+			return -alphabeta<next_state, next_team>(&child, state, d, -hi, -lo, ctx, ply + 1);
+		}
+	};
+
+	if constexpr (S == ACTION) {
+		// the skip action is a legal null move, if skipping the action still fails high at a
+		// reduced depth the other actions likely do too. The cutoff is verified by a reduced
+		// search of this node without the null move. A team that skipped last turn doesn't
+		// try it again, so skips don't pile up towards a surrender.
+		if (ctx.null_move && null_ok && ply > 0 && depth >= NULL_MOVE_MIN_DEPTH
+				&& beta != std::numeric_limits<float>::infinity() && state.get_passes(T) == 0
+				&& heuristic(state) * (T == BLACK ? 1 : -1) >= beta) {
+			AB_Node &skip = node->children[node->num_children - 1];
+			const float below_beta = std::nextafter(beta, -std::numeric_limits<float>::infinity());
+			const undo u = state.make_move_for<S, T>(skip.move);
+			float score = search(skip, depth - 1 - NULL_MOVE_REDUCTION, below_beta, beta);
+			state.unmake_for<S, T>(u);
+			if (score >= beta && !ctx.aborted) {
+				score = alphabeta<S, T>(node, state, depth - NULL_MOVE_REDUCTION, below_beta, beta, ctx, ply, false);
+			}
+			if (ctx.aborted) {
+				return 0;
+			}
+			if (score >= beta) {
+				node->value = score;
+				return score;
+			}
+		}
+	}
+
+	// the children are picked in order of their rank, the transposition table move first, then
+	// the killers of this ply, then the rest by key, without moving the nodes
+	const int n = node->num_children;
+	const MoveChoice *killers = ply < MAX_PLY ? ctx.killers[ply] : nullptr;
+	uint_fast8_t order[MAX_CHILDREN];
+	int rank[MAX_CHILDREN];
+	float order_key[MAX_CHILDREN];
+	for (int i = 0; i < n; ++i) {
+		const AB_Node &child = node->children[i];
+		order[i] = i;
+		rank[i] = 0;
+		if (child.move_index == tt_move) {
+			rank[i] = NUM_KILLERS + 1;
+		} else if (killers) {
+			for (int k = 0; k < NUM_KILLERS; ++k) {
+				if (same_move<S>(child.move, killers[k])) {
+					rank[i] = NUM_KILLERS - k;
+					break;
+				}
+			}
+		}
+		order_key[i] = searched ? (next_team == T ? child.value : -child.value) : history<S, T>(ctx, child.move);
+	}
+	// selection sort that stops at the cutoff, returns the child to search i-th
+	auto pick = [&](int i) -> AB_Node & {
+		int best = i;
+		for (int j = i + 1; j < n; ++j) {
+			const int a = order[j];
+			const int b = order[best];
+			if (rank[a] > rank[b] || (rank[a] == rank[b] && order_key[a] > order_key[b])) {
+				best = j;
+			}
+		}
+		std::swap(order[i], order[best]);
+		return node->children[order[i]];
+	};
+	float val = -std::numeric_limits<float>::infinity();
+	int best_move = TT_NO_MOVE;
+	for (int i = 0; i < n; ++i) {
+		AB_Node &child = pick(i);
+		// quiet moves ordered late below the root are unlikely to raise alpha, swaps are all
+		// quiet as the action that follows decides what they achieve
+		bool reduce = ctx.reductions && ply > 0 && i >= LMR_MIN_MOVES && depth >= LMR_MIN_DEPTH && rank[order[i]] == 0;
+		if constexpr (S == ACTION) {
+			reduce = reduce && !state.kills(child.move.act);
+		}
+		const undo u = state.make_move_for<S, T>(child.move);
+		float score = alpha;
+		if (i == 0) {
+			score = search(child, depth - 1, alpha, beta);
+		} else {
+			// prove the child is no better than the best so far with a null window, first at
+			// a reduced depth for quiet moves, and search it again with the full window if
+			// it is
+			const float above_alpha = std::nextafter(alpha, std::numeric_limits<float>::infinity());
+			bool full_depth = true;
+			if (reduce) {
+				score = search(child, depth - 1 - LMR_REDUCTION, alpha, above_alpha);
+				full_depth = score > alpha;
+			}
+			if (full_depth && !ctx.aborted) {
+				score = search(child, depth - 1, alpha, above_alpha);
+			}
+			if (score > alpha && score < beta && !ctx.aborted) {
+				score = search(child, depth - 1, alpha, beta);
+			}
+		}
+		state.unmake_for<S, T>(u);
+		if (ctx.aborted) {
+			return 0;
+		}
+		if (score > val || best_move == TT_NO_MOVE) {
+			val = score;
+			best_move = child.move_index;
+		}
+		alpha = std::max(alpha, val);
+		if (alpha >= beta) {
+			SEARCH_STAT(if (ctx.stats) ++ctx.stats->cutoffs[std::min(i, CUTOFF_BUCKETS - 1)];)
+			record_cutoff<S, T>(ctx, child.move, depth, ply);
+			break;
+		}
+	}
+	node->value = val;
+
+	if (ply == 0) {
+		// children that failed low may tie with the best value, so the best move can't be
+		// recovered from the values alone
+		ctx.root_move = best_move;
+	}
+
+	entry.score = val;
+	entry.depth = depth;
+	entry.move = best_move;
+	if (val <= alpha_orig) {
+		entry.bound = UPPER_BOUND;
+	} else if (val >= beta) {
+		entry.bound = LOWER_BOUND;
 	} else {
-		// sort children based on most promising from previous searches, in this case from smallest to greatest value
-		std::sort(node->children.begin(), node->children.end(), [](AB_Node *a, AB_Node *b) { return a->value < b->value; });
-		
-		val = std::numeric_limits<float>::infinity();
-		for (auto &child : node->children) {
-			val = std::min(val, alphabeta(child, depth - 1, alpha, beta, maximizing));
+		entry.bound = EXACT;
+	}
+	tt.store(key, entry);
+
+	return val;
+}
+
+/* Description: searches root with alphabeta specialised on its state and team to play, returns
+ * 		the score from the point of view of the team to play at the root.
+ * Args: root - the root of the search tree.
+ * 	 state - the board state of root.
+ * 	 depth - the depth to search.
+ * 	 alpha - the lower bound of the window.
+ * 	 beta - the upper bound of the window.
+ * 	 ctx - the state of the thread's search.
+ */
+static float search_root(AB_Node *root, Board &state, int depth, float alpha, float beta, SearchContext &ctx)
+{
+	if (state.state == SWAP) {
+		if (state.to_play == BLACK) {
+			return alphabeta<SWAP, BLACK>(root, state, depth, alpha, beta, ctx, 0);
+		}
+		return alphabeta<SWAP, WHITE>(root, state, depth, alpha, beta, ctx, 0);
+	}
+	if (state.to_play == BLACK) {
+		return alphabeta<ACTION, BLACK>(root, state, depth, alpha, beta, ctx, 0);
+	}
+	return alphabeta<ACTION, WHITE>(root, state, depth, alpha, beta, ctx, 0);
+}
+
+/* Description: searches root to depth with an aspiration window around guess, widening the
+ * 		window on the side the score fell outside of until the score is exact.
+ * Args: root - the root of the search tree.
+ * 	 state - the board state of root.
+ * 	 depth - the depth to search.
+ * 	 guess - the expected score, usually the score of the previous iteration, the
+ * 		 full window is searched if it isn't finite.
+ * 	 ctx - the state of the thread's search.
+ */
+static float search_aspiration(AB_Node *root, Board &state, int depth, float guess, SearchContext &ctx)
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	float delta = ASPIRATION_WINDOW;
+	float alpha = std::isfinite(guess) ? guess - delta : -inf;
+	float beta = std::isfinite(guess) ? guess + delta : inf;
+
+	while (true) {
+		const float score = search_root(root, state, depth, alpha, beta, ctx);
+		if (ctx.aborted) {
+			return score;
+		}
+		delta *= ASPIRATION_GROWTH;
+		if (score <= alpha && alpha != -inf) {
+			alpha = delta < ASPIRATION_MAX ? guess - delta : -inf;
+		} else if (score >= beta && beta != inf) {
+			beta = delta < ASPIRATION_MAX ? guess + delta : inf;
+		} else {
+			return score;
+		}
+	}
+}
+
+/*
+ * Point where the younger brothers of a node are searched in parallel, cancelling it
+ * aborts the searches of every node below it.
+ */
+struct SplitPoint {
+	const SplitPoint *parent;
+	std::atomic<bool> cancelled;
+
+	bool is_cancelled() const
+	{
+		for (const SplitPoint *s = this; s; s = s->parent) {
+			if (s->cancelled.load(std::memory_order_relaxed)) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/*
+ * State of a deterministic search below one split point.
+ */
+struct YBWContext {
+	Team maximizing;
+	const SplitPoint *split; // innermost split point above the nodes being searched
+	bool aborted; // true once a split point above was cancelled
+};
+
+static float ybw_alphabeta(AB_Node *node, Board &state, int depth, float alpha, float beta, YBWContext &ctx);
+
+/*
+ * Search of one younger brother, run by whichever worker takes it.
+ */
+struct SiblingTask : Task {
+	AB_Node *node;
+	Board state; // board state of the parent node
+	int depth;
+	float alpha;
+	float beta;
+	YBWContext ctx;
+	float saved_value; // value of the node before the search, restored if it is cancelled
+	float score;
+
+	void run() override
+	{
+		// the board is a copy, no need to unmake
+		this->state.make_move(this->node->move);
+		this->score = ybw_alphabeta(this->node, this->state, this->depth, this->alpha, this->beta, this->ctx);
+	}
+};
+
+/* Description: waits for a task pushed by the calling worker to finish, running it on
+ * 		the calling thread if no other worker took it yet when run is true, or
+ * 		dropping it otherwise. Returns true if the task was run.
+ * Args: t - the task to wait for.
+ * 	 run - whether to run the task if it has not started.
+ */
+static bool wait_for(SiblingTask &t, bool run)
+{
+	if (pool.reclaim(&t)) {
+		if (run) {
+			t.run();
+		}
+		t.finish();
+		return run;
+	}
+	// help with other work while the task runs elsewhere
+	while (!t.done()) {
+		if (!pool.run_one()) {
+			std::this_thread::yield();
+		}
+	}
+	return true;
+}
+
+/*
+ * Young brothers wait search: the first child of a node is searched on its own, the
+ * remaining children are then handed to the pool with the window it produced. The
+ * window of the younger brothers is not narrowed as their results come in and the
+ * results are combined in child order, siblings after a cutoff are cancelled and
+ * their subtrees reset whether or not they were searched. The result therefore does
+ * not depend on the number of threads or on which thread finished first.
+ */
+static float ybw_alphabeta(AB_Node *node, Board &state, int depth, float alpha, float beta, YBWContext &ctx)
+{
+	if (ctx.split && ctx.split->is_cancelled()) {
+		ctx.aborted = true;
+		return 0;
+	}
+	if (depth <= 0 or node->is_leaf(state)) {
+		node->value = heuristic(state) * (ctx.maximizing == BLACK ? 1 : -1);
+		return node->value;
+	}
+
+	node->expand(state, worker_arenas[ThreadPool::worker_id()]);
+	AB_Node *children = node->children;
+	const int n = node->num_children;
+
+	// comparing sign * score lets maximizing and minimizing nodes share the code below
+	const float sign = state.to_play == ctx.maximizing ? 1 : -1;
+	std::sort(node->begin(), node->end(), [sign](AB_Node &a, AB_Node &b) { return sign * a.value > sign * b.value; });
+
+	float val = -sign * std::numeric_limits<float>::infinity();
+	// returns true on a cutoff
+	auto update = [&](float score) {
+		if (sign * score > sign * val) {
+			val = score;
+		}
+		if (sign > 0) {
+			alpha = std::max(alpha, val);
+		} else {
 			beta = std::min(beta, val);
-			if (beta <= alpha)
-				break;
 		}
+		return alpha >= beta;
+	};
+
+	const int serial = depth >= YBW_MIN_SPLIT_DEPTH ? 1 : n;
+	for (int i = 0; i < serial; ++i) {
+		const undo u = state.make_move(children[i].move);
+		const float score = ybw_alphabeta(&children[i], state, depth - 1, alpha, beta, ctx);
+		state.unmake(u);
+		if (ctx.aborted) {
+			return 0;
+		}
+		if (update(score)) {
+			node->value = val;
+			return val;
+		}
+	}
+	if (serial == n) {
 		node->value = val;
+		return val;
+	}
+
+	SplitPoint split{ctx.split, {false}};
+	SiblingTask *tasks = worker_arenas[ThreadPool::worker_id()].construct<SiblingTask>(n - 1);
+	// pushed in reverse so the next sibling needed is at the back of this worker's deque
+	for (int i = n - 1; i >= 1; --i) {
+		SiblingTask &t = tasks[i - 1];
+		t.node = &children[i];
+		t.state = state;
+		t.depth = depth - 1;
+		t.alpha = alpha;
+		t.beta = beta;
+		t.ctx = YBWContext{ctx.maximizing, &split, false};
+		t.saved_value = children[i].value;
+		pool.push(&t);
+	}
+
+	int cancel_from = n;
+	for (int i = 1; i < n; ++i) {
+		SiblingTask &t = tasks[i - 1];
+		wait_for(t, true);
+		// a split point above this node was cancelled
+		if (t.ctx.aborted) {
+			ctx.aborted = true;
+			cancel_from = i;
+			break;
+		}
+		if (update(t.score)) {
+			cancel_from = i + 1;
+			break;
+		}
 	}
 
+	if (cancel_from < n) {
+		split.cancelled.store(true, std::memory_order_relaxed);
+		for (int i = cancel_from; i < n; ++i) {
+			SiblingTask &t = tasks[i - 1];
+			wait_for(t, false);
+			// leave the sibling as if it had not been searched
+			t.node->value = t.saved_value;
+			t.node->children = nullptr;
+			t.node->num_children = 0;
+		}
+	}
+
+	if (ctx.aborted) {
+		return 0;
+	}
+	node->value = val;
 	return val;
 }
 
-int suggest_move(Board &state, int depth)
+/* Description: runs iterative deepening on a helper thread until stop is set or the
+ * 		maximum depth is searched, the results only reach the main thread
+ * 		through the transposition table.
+ * Args: state - the board state to search.
+ * 	 arena - the arena to allocate this thread's tree from.
+ * 	 first - the depth of the first iteration.
+ * 	 depth - the maximum depth to search.
+ * 	 stop - set by the main thread when its search is done.
+ * 	 options - configures the pruning of the search.
+ */
+static void helper_search(Board state, Arena &arena, int first, int depth, const std::atomic<bool> &stop,
+		SearchOptions options)
 {
-	AB_Node *root = new AB_Node{state};
+	SearchContext ctx{arena, &stop, options};
+	AB_Node *root = arena.construct<AB_Node>(1);
 
-	// for each empty tile add one to depth
-	for (auto &tile : state.tile_info()) {
-		depth += tile.hp <= 0;
+	float score = std::numeric_limits<float>::infinity();
+	for (int d = first; d <= depth && !ctx.aborted; ++d) {
+		score = search_aspiration(root, state, d, score, ctx);
 	}
+	arena.release();
+}
 
-	// use iterative deepening depth first search
-	for (int d = 0; d <= depth; ++d) {
-		int ret = alphabeta(root, d, -std::numeric_limits<float>::infinity(),
-				std::numeric_limits<float>::infinity(), state.to_play);
+/* Description: searches root with iterative deepening on the calling thread while
+ * 		threads - 1 helper threads search the same position, sharing the
+ * 		transposition table. Returns the index of the best move
+ * 		of the last completed iteration, fallback if the search was stopped before one completed.
+ * Args: tree - the arena the nodes below root are allocated from.
+ * 	 root - the root of the search tree.
+ * 	 board - the board state of root.
+ * 	 first - the depth to resume iterative deepening at, deeper than 1 if the tree was
+ * 	 	already searched by an earlier search.
+ * 	 fallback - the move an earlier search of root picked, -1 if none. The limits of the
+ * 	 	options can't stop an iteration until there is a move to return, so without one
+ * 	 	a depth 1 iteration is searched before resuming at first.
+ * 	 depth - the maximum depth to search.
+ * 	 score - the expected score of the first iteration, infinite if unknown. Set to the
+ * 	 	score of the last completed iteration.
+ * 	 reached - set to the depth of the last completed iteration, unchanged if none completed.
+ * 	 options - the number of threads to search with and the pruning to use.
+ * 	 stats - gets the statistics of the main thread's search if not nullptr.
+ */
+static int search_lazy_smp(Arena &tree, AB_Node *root, Board &board, int first, int fallback, int depth, float &score,
+		int &reached, const SearchOptions &options, SearchStats *stats)
+{
+	SearchContext ctx{tree, options.stop, options};
+	ctx.stats = stats;
+	ctx.limited = fallback != -1;
+	ctx.node_limit = options.node_limit;
+	if (options.time_limit.count() > 0) {
+		ctx.deadline = std::chrono::steady_clock::now() + options.time_limit;
+	}
+
+	// helpers start one or two plies ahead of the main thread so that the threads spread
+	// out over different depths and fill the table with entries the main thread needs next
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> helpers;
+	const size_t num_helpers = std::max(options.threads - 1, 0);
+	if (helper_arenas.size() < num_helpers) {
+		helper_arenas.resize(num_helpers);
+	}
+	for (size_t i = 0; i < num_helpers; ++i) {
+		helpers.emplace_back(helper_search, board, std::ref(helper_arenas[i]), 1 + i % 2, depth, std::cref(stop), options);
+	}
+
+	// use iterative deepening depth first search, each iteration expects a score close to
+	// the score of the previous one. Start at depth 1 at least, a depth 0 search only
+	// evaluates the root, which the quiescence search can find won without picking a move.
+	depth = std::max(depth, 1);
+	float ret = score;
+	// ctx.root_move is also set by the searches of an iteration that fail low or high in
+	// their aspiration window, only the move of a completed iteration can be trusted
+	int move = fallback == -1 ? TT_NO_MOVE : fallback;
+	const int resume = std::min(std::max(first, 1), depth);
+	for (int d = ctx.limited ? resume : 1; d <= depth; d = std::max(d + 1, resume)) {
+		const auto start = std::chrono::steady_clock::now();
+		const uint64_t nodes = ctx.nodes;
+		ret = search_aspiration(root, board, d, ret, ctx);
+		// out of time or nodes, the move of the last completed iteration is kept
+		if (ctx.aborted) {
+			break;
+		}
+		score = ret;
+		reached = d;
+		move = ctx.root_move;
+		ctx.limited = true;
+		if (stats) {
+			const std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+			stats->iterations.push_back(IterationStats{d, ctx.nodes - nodes, ms.count(), ret, ctx.root_move});
+		}
 		// found a winning position or all positions are losing
 		if (ret == std::numeric_limits<float>::infinity() || ret == -std::numeric_limits<float>::infinity()) {
 			break;
 		}
 	}
 
-	auto max_child = *std::max_element(root->children.begin(), root->children.end(), 
-			[](AB_Node *a, AB_Node *b) { return a->value < b->value; });
-	const int index = max_child->move_index;
-	delete root;
+	stop.store(true, std::memory_order_relaxed);
+	for (auto &t : helpers) {
+		t.join();
+	}
+	if (stats) {
+		stats->nodes += ctx.nodes;
+	}
+
+	return move == TT_NO_MOVE ? -1 : move;
+}
+
+/* Description: searches root with iterative deepening using the deterministic young
+ * 		brothers wait search on threads workers. Returns the index of the best move.
+ * Args: root - the root of the search tree.
+ * 	 board - the board state of root.
+ * 	 depth - the maximum depth to search.
+ * 	 threads - the total number of threads to search with.
+ */
+static int search_deterministic(AB_Node *root, Board &board, int depth, int threads)
+{
+	pool.resize(threads);
+	if (worker_arenas.size() < (size_t)pool.size()) {
+		worker_arenas.resize(pool.size());
+	}
+	YBWContext ctx{board.to_play, nullptr, false};
+
+	for (int d = 0; d <= depth; ++d) {
+		float ret = ybw_alphabeta(root, board, d, -std::numeric_limits<float>::infinity(),
+				std::numeric_limits<float>::infinity(), ctx);
+		if (ret == std::numeric_limits<float>::infinity() || ret == -std::numeric_limits<float>::infinity()) {
+			break;
+		}
+	}
+
+	// the children are left sorted from best to worst, so ties go to the child searched first
+	auto max_child = std::max_element(root->begin(), root->end(),
+			[](AB_Node &a, AB_Node &b) { return a.value < b.value; });
+	return max_child->move_index;
+}
+
+/* Description: returns the depth to search state to when suggest_move is asked for depth.
+ * Args: state - the board state to search.
+ * 	 depth - the depth passed to suggest_move.
+ * 	 options - the options passed to suggest_move.
+ */
+static int search_depth(Board &state, int depth, const SearchOptions &options)
+{
+	if (depth <= 0) {
+		if (!options.deterministic) {
+			// search until a limit of the options is reached
+			return MAX_PLY - 1;
+		}
+		depth = YBW_DEFAULT_DEPTH;
+	}
+	// for each empty tile add one to depth
+	for (auto &tile : state.tile_info()) {
+		depth += tile.hp <= 0;
+	}
+	return depth;
+}
+
+/* Description: copies the children of node and their subtrees below copy, allocating them
+ * 		from arena.
+ * Args: copy - the copy of node.
+ * 	 node - the node whose subtree is copied.
+ * 	 arena - the arena to allocate the copies from.
+ */
+static void copy_children(AB_Node &copy, const AB_Node &node, Arena &arena)
+{
+	if (node.num_children == 0) {
+		return;
+	}
+	copy.children = arena.construct<AB_Node>(node.num_children);
+	for (int i = 0; i < node.num_children; ++i) {
+		copy.children[i] = node.children[i];
+		copy_children(copy.children[i], node.children[i], arena);
+	}
+}
+
+int suggest_move(Board &state, int depth, const SearchOptions &options, SearchResult *result)
+{
+	AB_Node *root = arena.construct<AB_Node>(1);
+	// the search makes and unmakes moves on a single copy of the board
+	Board board{state};
+
+	// table scores are relative to the team to play at each node, so the entries of earlier
+	// searches stay valid, they are only replaced first
+	tt.new_search();
+	depth = search_depth(state, depth, options);
+
+	int index;
+	float score = std::numeric_limits<float>::infinity();
+	int reached = 0;
+	if (options.deterministic) {
+		index = search_deterministic(root, board, depth, options.threads);
+		reached = depth;
+		score = std::max_element(root->begin(), root->end(),
+				[](AB_Node &a, AB_Node &b) { return a.value < b.value; })->value;
+	} else {
+		index = search_lazy_smp(arena, root, board, 1, -1, depth, score, reached, options,
+				result ? &result->stats : nullptr);
+	}
+	if (result) {
+		result->move = index;
+		result->score = score;
+		result->depth = reached;
+	}
+	// the whole tree is freed at once
+	arena.release();
+	for (auto &a : worker_arenas) {
+		a.release();
+	}
+
+	return index;
+}
+
+SearchSession::SearchSession(): current{0}, root{nullptr}, reached{0}, plies{0},
+	score{std::numeric_limits<float>::infinity()}, move{-1}
+{
+}
+
+void SearchSession::reset(const Board &state)
+{
+	this->arenas[this->current].release();
+	this->root = this->arenas[this->current].construct<AB_Node>(1);
+	this->board = state;
+	this->reached = 0;
+	this->plies = 0;
+	this->score = std::numeric_limits<float>::infinity();
+	this->move = -1;
+}
+
+void SearchSession::advance(const MoveChoice &m)
+{
+	if (!this->root) {
+		return;
+	}
+
+	// the human's swaps may name the positions in either order
+	auto matches = [&](const AB_Node &child) {
+		if (this->board.state == SWAP) {
+			return (child.move.swap.first == m.swap.first && child.move.swap.second == m.swap.second)
+				|| (child.move.swap.first == m.swap.second && child.move.swap.second == m.swap.first);
+		}
+		return child.move.act.pos == m.act.pos && child.move.act.trgts == m.act.trgts;
+	};
+	AB_Node *child = std::find_if(this->root->begin(), this->root->end(), matches);
+	if (child == this->root->end()) {
+		// the move was never searched, the next search starts over
+		this->root = nullptr;
+		return;
+	}
+
+	this->board.make_move(child->move);
+	this->root = child;
+	this->plies += 1;
+	this->score = child->value;
+	this->move = -1;
+}
+
+int SearchSession::suggest_move(Board &state, int depth, const SearchOptions &options, SearchResult *result)
+{
+	if (options.deterministic) {
+		// the deterministic search builds its own tree
+		this->root = nullptr;
+		return ::suggest_move(state, depth, options, result);
+	}
+	if (!this->root || this->board.hash() != state.hash()) {
+		reset(state);
+	} else if (this->plies > 0) {
+		// copy the subtree that is still reachable to the other arena and drop the rest
+		Arena &to = this->arenas[1 - this->current];
+		to.release();
+		AB_Node *root = to.construct<AB_Node>(1);
+		*root = *this->root;
+		copy_children(*root, *this->root, to);
+		this->arenas[this->current].release();
+		this->current = 1 - this->current;
+		this->root = root;
+		// the subtree was searched as deep as the old root, less the plies played since
+		this->reached = std::max(this->reached - this->plies, 0);
+		this->plies = 0;
+	}
+
+	depth = search_depth(state, depth, options);
+	// a search of this position at least as deep already picked a move, e.g. the hint search
+	// before the computer's search of the same depth
+	if (this->move != -1 && this->reached >= depth) {
+		if (result) {
+			result->move = this->move;
+			result->score = this->score;
+			result->depth = this->reached;
+		}
+		return this->move;
+	}
 
+	tt.new_search();
+	if (this->reached == 0) {
+		this->score = std::numeric_limits<float>::infinity();
+	}
+	// iterative deepening resumes at the depth the tree was already searched to. The move an
+	// earlier search of this root picked is kept if the limits stop that iteration, after the
+	// tree was re-rooted there is none and a depth 1 iteration picks one first.
+	Board board{this->board};
+	const int index = search_lazy_smp(this->arenas[this->current], this->root, board, this->reached, this->move,
+			depth, this->score, this->reached, options, result ? &result->stats : nullptr);
+	if (index != -1) {
+		this->move = index;
+	}
+	if (result) {
+		result->move = index;
+		result->score = this->score;
+		result->depth = this->reached;
+	}
 	return index;
 }
+
+void start_pondering(const Board &state, int depth, const SearchOptions &options, SearchSession *session)
+{
+	stop_pondering();
+
+	SearchOptions ponder_options{options};
+	ponder_options.stop = &ponder_stop;
+	ponder_stop.store(false, std::memory_order_relaxed);
+	ponder_thread = std::thread([state, depth, ponder_options, session]() {
+		Board board{state};
+		if (session) {
+			session->suggest_move(board, depth, ponder_options);
+		} else {
+			suggest_move(board, depth, ponder_options);
+		}
+	});
+}
+
+void stop_pondering()
+{
+	if (ponder_thread.joinable()) {
+		ponder_stop.store(true, std::memory_order_relaxed);
+		ponder_thread.join();
+	}
+}
+
+/* Description: returns x as a JSON value, JSON has no infinite numbers so the scores of won and
+ * 		lost positions are written as strings.
+ * Args: x - the number to format.
+ */
+static std::string json_number(double x)
+{
+	if (std::isinf(x)) {
+		return x > 0 ? "\"inf\"" : "\"-inf\"";
+	}
+	if (std::isnan(x)) {
+		return "null";
+	}
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%.6g", x);
+	return buf;
+}
+
+std::string to_json(const SearchResult &result)
+{
+	const SearchStats &s = result.stats;
+	uint64_t cutoffs = 0;
+	for (int i = 0; i < CUTOFF_BUCKETS; ++i) {
+		cutoffs += s.cutoffs[i];
+	}
+	double ms = 0;
+	for (auto &it : s.iterations) {
+		ms += it.ms;
+	}
+
+	std::string out = "{\"move\":" + std::to_string(result.move)
+		+ ",\"score\":" + json_number(result.score)
+		+ ",\"depth\":" + std::to_string(result.depth)
+		+ ",\"nodes\":" + std::to_string(s.nodes)
+		+ ",\"ms\":" + json_number(ms)
+		+ ",\"nodes_per_second\":" + json_number(ms > 0 ? s.nodes * 1000.0 / ms : 0)
+		+ ",\"leaves\":" + std::to_string(s.leaves)
+		+ ",\"quiescence_moves\":" + std::to_string(s.quiescence_moves)
+		+ ",\"expanded\":" + std::to_string(s.expanded)
+		+ ",\"children\":" + std::to_string(s.children)
+		+ ",\"tt_probes\":" + std::to_string(s.tt_probes)
+		+ ",\"tt_hits\":" + std::to_string(s.tt_hits)
+		+ ",\"tt_cutoffs\":" + std::to_string(s.tt_cutoffs)
+		+ ",\"tt_hit_rate\":" + json_number(s.tt_probes ? (double)s.tt_hits / s.tt_probes : 0)
+		+ ",\"cutoffs\":[";
+	for (int i = 0; i < CUTOFF_BUCKETS; ++i) {
+		out += (i ? "," : "") + std::to_string(s.cutoffs[i]);
+	}
+	out += "],\"first_move_cutoff_rate\":" + json_number(cutoffs ? (double)s.cutoffs[0] / cutoffs : 0)
+		+ ",\"iterations\":[";
+	for (size_t i = 0; i < s.iterations.size(); ++i) {
+		const IterationStats &it = s.iterations[i];
+		// the effective branching factor is the growth of the nodes from the previous depth
+		const IterationStats *prev = i > 0 && s.iterations[i - 1].depth == it.depth - 1 ? &s.iterations[i - 1] : nullptr;
+		out += std::string{i ? "," : ""} + "{\"depth\":" + std::to_string(it.depth)
+			+ ",\"nodes\":" + std::to_string(it.nodes)
+			+ ",\"ms\":" + json_number(it.ms)
+			+ ",\"score\":" + json_number(it.score)
+			+ ",\"move\":" + std::to_string(it.move)
+			+ ",\"branching_factor\":" + (prev && prev->nodes ? json_number((double)it.nodes / prev->nodes) : "null")
+			+ "}";
+	}
+	out += "]}";
+
+	return out;
+}
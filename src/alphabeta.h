@@ -1,11 +1,160 @@
+#include <atomic>
+#include <chrono>
 #include <limits>
 #include <algorithm>
+#include <string>
+#include <vector>
 #include "ab_node.h"
 
+// number of buckets counting beta cutoffs by the index of the child that caused them
+#define CUTOFF_BUCKETS 8
 
+
+struct SearchOptions {
+	// number of threads searching the position, helper threads share the transposition
+	// table with the main thread (lazy SMP)
+	int threads = 1;
+	// search with young brothers wait on a work stealing pool instead, the move returned
+	// only depends on the position and depth, not on the number of threads or their
+	// timing. The transposition table is not used by this search.
+	bool deterministic = false;
+	// search quiet moves ordered late at a reduced depth first, ignored by the deterministic search
+	bool late_move_reductions = true;
+	// skip the action at a reduced depth to prove cutoffs early, ignored by the deterministic
+	// search. Off by default as the reduced searches miss too many threats in this game.
+	bool null_move = false;
+	// resolve the kills and medic saves available to the team acting at the horizon before
+	// evaluating it, ignored by the deterministic search
+	bool quiescence = true;
+	// stop the search once it has run for this long or the main thread has visited this many
+	// nodes and return the move of the last completed iteration. The first iteration always
+	// completes, at depth 1, unless a SearchSession can fall back on the move of an earlier
+	// search of the position. 0 for no limit, both are ignored by the deterministic search.
+	std::chrono::milliseconds time_limit{0};
+	uint64_t node_limit = 0;
+	// stops the search when set by another thread, even during the first iteration. Ignored
+	// by the deterministic search.
+	const std::atomic<bool> *stop = nullptr;
+};
+
+/*
+ * One completed iteration of iterative deepening.
+ */
+struct IterationStats {
+	int depth;
+	uint64_t nodes; // nodes visited, including the re-searches of the aspiration windows
+	double ms;
+	float score;
+	int move;
+};
+
+/*
+ * Counters of the main search thread, the deterministic search doesn't fill them. The nodes
+ * and iterations are always recorded, the other counters cost time in the inner loop and are
+ * only counted when built with FF_SEARCH_STATS defined (the FASTFEUD_SEARCH_STATS CMake
+ * option), they stay zero otherwise.
+ */
+struct SearchStats {
+	uint64_t nodes = 0; // calls of the search
+	uint64_t leaves = 0; // positions evaluated at the horizon or because the game is over
+	uint64_t quiescence_moves = 0; // actions searched by the quiescence search
+	uint64_t expanded = 0; // nodes whose children were generated
+	uint64_t children = 0; // children generated by those nodes
+	uint64_t tt_probes = 0;
+	uint64_t tt_hits = 0;
+	uint64_t tt_cutoffs = 0; // hits whose score was returned without searching
+	// beta cutoffs by the index of the child that caused them in search order, the last
+	// bucket also counts the later children
+	uint64_t cutoffs[CUTOFF_BUCKETS] = {};
+	std::vector<IterationStats> iterations;
+};
+
+struct SearchResult {
+	int move = -1; // the move returned by suggest_move
+	// score of the last completed iteration, from the point of view of the team to play
+	float score = 0;
+	int depth = 0; // depth of the last completed iteration
+	SearchStats stats;
+};
+
+/* Description: returns result as a JSON object on one line, adding the first move cutoff rate,
+ * 		the table hit rate and the effective branching factor of each iteration.
+ * Args: result - the result to convert.
+ */
+std::string to_json(const SearchResult &result);
+/* Description: returns a static evaluation of the board, positive values favour BLACK and
+ * 		negative values favour WHITE. Won positions evaluate to +/- infinity.
+ * Args: state - the board state to evaluate.
+ */
+float heuristic(Board &state);
 /* Description: returns the index of a move for the current board state using
- * 		alpha beta pruning with iterative deepening depth first search.
+ * 		alpha beta pruning with iterative deepening depth first search, or -1 if the
+ * 		search was stopped before it picked a move.
  * Args: state - the board state to return a move for.
- * 	 depth - how deep into the game tree to search.
+ * 	 depth - how deep into the game tree to search, one ply is added for each empty
+ * 	 	tile. 0 to search until a limit or the stop flag of the options stops
+ * 	 	the search, the deterministic search has neither and searches 4 plies.
+ * 	 options - configures how the search is run.
+ * 	 result - filled with the outcome and statistics of the search if not nullptr.
+ */
+int suggest_move(Board &state, int depth, const SearchOptions &options = SearchOptions{},
+		SearchResult *result = nullptr);
+/*
+ * Search tree kept between the searches of a game. The moves played since the last search
+ * re-root the tree onto their subtree, which keeps the values and ordering found below them,
+ * and iterative deepening starts at the depth that subtree was already searched to. Like
+ * suggest_move, nothing else may search while a session searches.
+ */
+class SearchSession {
+	// the tree is copied to the other arena when it is re-rooted, dropping the rest of it
+	Arena arenas[2];
+	int current;
+	AB_Node *root; // nullptr if the next search starts a new tree
+	Board board; // the board state of root
+	int reached; // depth root was searched to, not counting the plies played since
+	int plies; // moves played since the last search
+	float score; // score of root from the point of view of the team to play
+	int move; // index of the move picked by the deepest search of root, -1 if none
+
+	/* Description: starts a new tree for state.
+	 * Args: state - the board state of the new root.
+	 */
+	void reset(const Board &state);
+
+	public:
+
+	SearchSession();
+	/* Description: suggest_move reusing the tree of the session if state is the position it
+	 * 		was re-rooted onto, the tree is started over otherwise. Searches of the root
+	 * 		continue from the depth the earlier ones reached, and return the move they
+	 * 		picked without searching if they already reached depth.
+	 * Args: state - the board state to return a move for.
+	 * 	 depth - how deep into the game tree to search, as for suggest_move.
+	 * 	 options - configures how the search is run, the deterministic search doesn't
+	 * 	 	use the tree.
+	 * 	 result - filled with the outcome and statistics of the search if not nullptr.
+	 */
+	int suggest_move(Board &state, int depth, const SearchOptions &options = SearchOptions{},
+			SearchResult *result = nullptr);
+	/* Description: re-roots the tree onto the child reached by m, to be called for each move
+	 * 		played from the position of the last search.
+	 * Args: m - the move played.
+	 */
+	void advance(const MoveChoice &m);
+};
+
+/* Description: starts searching state on a background thread until stop_pondering is called,
+ * 		the entries it leaves in the transposition table speed up the searches of the
+ * 		positions that follow. Nothing else may search until it is stopped.
+ * Args: state - the board state to search, usually the position the opponent is thinking on.
+ * 	 depth - the maximum depth to search, 0 to search until stopped or a limit is reached.
+ * 	 options - configures how the search is run, its stop flag is replaced.
+ * 	 session - searches with the tree of session if not nullptr, so it is kept too.
+ */
+void start_pondering(const Board &state, int depth, const SearchOptions &options = SearchOptions{},
+		SearchSession *session = nullptr);
+/* Description: stops the search started by start_pondering and waits for it to finish, does
+ * 		nothing if no search is running.
+ * Args: None
  */
-int suggest_move(Board &state, int depth);
+void stop_pondering();
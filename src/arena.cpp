@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cstdint>
+#include "arena.h"
+
+
+Arena::Arena(size_t block_size): block_size{block_size}, current{0}, used{0}
+{
+}
+
+void Arena::next_block(size_t bytes)
+{
+	// reuse blocks left over from previous searches when they are large enough
+	while (this->current + 1 < this->blocks.size()) {
+		++this->current;
+		this->used = 0;
+		if (this->sizes[this->current] >= bytes) {
+			return;
+		}
+	}
+
+	const size_t size = std::max(bytes, this->block_size);
+	this->blocks.emplace_back(new char[size]);
+	this->sizes.push_back(size);
+	this->current = this->blocks.size() - 1;
+	this->used = 0;
+}
+
+void *Arena::allocate(size_t bytes, size_t align)
+{
+	if (this->blocks.empty()) {
+		next_block(bytes + align);
+	}
+
+	uintptr_t base = reinterpret_cast<uintptr_t>(this->blocks[this->current].get());
+	uintptr_t start = (base + this->used + align - 1) & ~(uintptr_t)(align - 1);
+
+	if (start + bytes > base + this->sizes[this->current]) {
+		next_block(bytes + align);
+		base = reinterpret_cast<uintptr_t>(this->blocks[this->current].get());
+		start = (base + align - 1) & ~(uintptr_t)(align - 1);
+	}
+
+	this->used = start + bytes - base;
+	return reinterpret_cast<void *>(start);
+}
+
+void Arena::release()
+{
+	this->current = 0;
+	this->used = 0;
+}
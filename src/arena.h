@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+/*
+ * Monotonic allocator handing out memory from large blocks. Memory is never
+ * freed individually, release() makes every block available again in O(1)
+ * so the blocks are reused by the next search. Only trivially destructible
+ * objects should be allocated since destructors are never run.
+ */
+class Arena {
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::vector<size_t> sizes;
+	size_t block_size;
+	size_t current; // index of the block being allocated from
+	size_t used; // bytes used in the current block
+
+	/* Description: moves on to the next block that can hold bytes, allocating it if needed.
+	 * Args: bytes - the minimum number of free bytes the block must have.
+	 */
+	void next_block(size_t bytes);
+
+	public:
+
+	/* Description: creates an empty arena, memory is allocated in blocks of block_size bytes.
+	 * Args: block_size - size of each block in bytes.
+	 */
+	Arena(size_t block_size = 1 << 20);
+	/* Description: returns bytes of uninitialised memory aligned to align.
+	 * Args: bytes - the number of bytes to allocate.
+	 * 	 align - the alignment of the memory, must be a power of two.
+	 */
+	void *allocate(size_t bytes, size_t align);
+	/* Description: returns an array of n default constructed objects of type T.
+	 * Args: n - the number of objects to construct.
+	 */
+	template <typename T>
+	T *construct(size_t n)
+	{
+		T *out = static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+		for (size_t i = 0; i < n; ++i) {
+			new (out + i) T();
+		}
+		return out;
+	}
+	/* Description: invalidates all allocations, the blocks are kept for reuse.
+	 * Args: None
+	 */
+	void release();
+};
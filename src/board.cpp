@@ -1,69 +1,71 @@
 #include "board.h"
 
 #ifdef __GNUC__
-#	define ffs(x) __builtin_ffs(x)
+#	define ffs(x) __builtin_ffsll(x)
+#	define popcount(x) __builtin_popcountll(x)
 #endif
 
 
-LookupTables Board::lookup;
+// piece weights of the evaluation, scaled by EVAL_SCALE / 2 since tile points come in halves
+static const int_fast16_t eval_weights[NUM_PIECES] = {20, 18, 12, 14, 14, 13};
 
 /*** LookupTables Implementations ***/
 
-LookupTables::LookupTables()
+template <int W, int H>
+constexpr LookupTables<W, H>::LookupTables(): neighbours{}, archer_attacks{}, zobrist_tiles{}, zobrist_action{0}, zobrist_white{0}, zobrist_passes{}
 {
 	compute_neighbours();
 	compute_archer_attacks();
-	compute_n_k_subsets();
+	compute_zobrist();
 }
 
-void LookupTables::compute_neighbours()
+template <int W, int H>
+constexpr void LookupTables<W, H>::compute_neighbours()
 {
 	const int_fast8_t dx[] = {-1, 0, 1, 0};
 	const int_fast8_t dy[] = {0, 1, 0, -1};
-	int_fast8_t x, y, x1, y1, bit;
 
-	for (uint_fast8_t i = 0; i < BOARD_SIZE; ++i) {
-		x = i % BOARD_WIDTH;
-		y = i / BOARD_WIDTH;
+	for (int i = 0; i < SIZE; ++i) {
+		const int x = i % W;
+		const int y = i / W;
 		this->neighbours[i] = 0;
 
-		for (uint_fast8_t j = 0; j < 4; ++j) {
-			x1 = x + dx[j];
-			y1 = y + dy[j];
-			if (x1 < 0 || BOARD_WIDTH <= x1 || y1 < 0 || BOARD_HEIGHT <= y1)
+		for (int j = 0; j < 4; ++j) {
+			const int x1 = x + dx[j];
+			const int y1 = y + dy[j];
+			if (x1 < 0 || W <= x1 || y1 < 0 || H <= y1)
 				continue;
-			bit = y1 * BOARD_WIDTH + x1;
-			this->neighbours[i] |= 1 << bit;
+			const int bit = y1 * W + x1;
+			this->neighbours[i] |= (bitmap_t)1 << bit;
 		}
 	}
 }
 
-void LookupTables::compute_archer_attacks()
+template <int W, int H>
+constexpr void LookupTables<W, H>::compute_archer_attacks()
 {
-	uint_fast16_t bb;
-
-	for (uint_fast8_t pos = 0; pos < BOARD_SIZE; ++pos) {
-		for (uint_fast8_t shield_pos = 0; shield_pos < BOARD_SIZE + 1; ++shield_pos) {
+	for (int pos = 0; pos < SIZE; ++pos) {
+		for (int shield_pos = 0; shield_pos < SIZE + 1; ++shield_pos) {
 			if (pos == shield_pos)
 				continue;
-			bb = 0;
-			for (int i = pos + 1; i >= 0 && i / BOARD_WIDTH == pos / BOARD_WIDTH; ++i) {
-				bb |= 1 << i;
+			bitmap_t bb = 0;
+			for (int i = pos + 1; i >= 0 && i / W == pos / W; ++i) {
+				bb |= (bitmap_t)1 << i;
 				if (i == shield_pos)
 					break;
 			}
-			for (int i = pos - 1; i >= 0 && i / BOARD_WIDTH == pos / BOARD_WIDTH; --i) {
-				bb |= 1 << i;
+			for (int i = pos - 1; i >= 0 && i / W == pos / W; --i) {
+				bb |= (bitmap_t)1 << i;
 				if (i == shield_pos)
 					break;
 			}	
-			for (int i = pos + BOARD_WIDTH; i >= 0 && i < BOARD_SIZE; i += BOARD_WIDTH) {
-				bb |= 1 << i;
+			for (int i = pos + W; i >= 0 && i < SIZE; i += W) {
+				bb |= (bitmap_t)1 << i;
 				if (i == shield_pos)
 					break;
 			}
-			for (int i = pos - BOARD_WIDTH; i >= 0 && i < BOARD_SIZE; i -= BOARD_WIDTH) {
-				bb |= 1 << i;
+			for (int i = pos - W; i >= 0 && i < SIZE; i -= W) {
+				bb |= (bitmap_t)1 << i;
 				if (i == shield_pos)
 					break;
 			}
@@ -73,42 +75,87 @@ void LookupTables::compute_archer_attacks()
 	}
 }
 
-static void comb(std::vector<std::vector<uint_fast8_t>> &res, std::vector<uint_fast8_t> data, int n, int k, int index, int i)
+template <int W, int H>
+constexpr void LookupTables<W, H>::compute_zobrist()
 {
-	if (index == k) {
-		res.push_back(data);
-		return;
+	// splitmix64 with a fixed seed so keys are stable between runs
+	uint_fast64_t seed = 0x46617374466575ULL;
+	auto next = [&seed]() {
+		uint_fast64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	};
+
+	for (int t = 0; t < NUM_TEAMS; ++t) {
+		for (int p = 0; p < NUM_PIECES; ++p) {
+			for (int hp = 0; hp < 5; ++hp) {
+				for (int pos = 0; pos < SIZE; ++pos) {
+					// dead pieces don't contribute to the key
+					this->zobrist_tiles[t][p][hp][pos] = hp > 0 ? next() : 0;
+				}
+			}
+		}
+		for (int i = 0; i < 4; ++i) {
+			this->zobrist_passes[t][i] = i > 0 ? next() : 0;
+		}
 	}
+	this->zobrist_action = next();
+	this->zobrist_white = next();
+}
 
-	if (i >= n) {
-		return;
-	}
+template <int W, int H>
+constexpr LookupTables<W, H> BasicBoard<W, H>::lookup;
+
+/*** Board Implementations ***/
 
-	data[index] = i;
-	comb(res, data, n, k, index + 1, i + 1);
-	comb(res, data, n, k, index, i + 1);
+template <int W, int H>
+bool BasicBoard<W, H>::inbound(uint_fast8_t pos) const
+{
+	return 0 <= pos && pos < SIZE;
 }
 
-void LookupTables::compute_n_k_subsets()
+template <int W, int H>
+uint_fast8_t BasicBoard<W, H>::hp_at(uint_fast8_t pos) const
 {
-	std::vector<uint_fast8_t> data;
+	// 16 nibbles to a word, a single word board always uses the first
+	const int word = HP_WORDS == 1 ? 0 : pos / 16;
+	return (this->hp[word] >> (4 * (pos % 16))) & 0xf;
+}
 
-	for (int n = 1; n <= 4; ++n) {
-		for (int k = 1; k <= 4; ++k) {
-			data.resize(k);
-			comb(this->n_k_subset[n - 1][k - 1], data, n, k, 0, 0);
-		}
-	}
+template <int W, int H>
+void BasicBoard<W, H>::set_hp(uint_fast8_t pos, uint_fast8_t hp)
+{
+	const int word = HP_WORDS == 1 ? 0 : pos / 16;
+	this->hp[word] &= ~((uint64_t)0xf << (4 * (pos % 16)));
+	this->hp[word] |= (uint64_t)hp << (4 * (pos % 16));
 }
 
-/*** Board Implementations ***/
+template <int W, int H>
+Team BasicBoard<W, H>::team_at(uint_fast8_t pos) const
+{
+	return (this->team_bitmaps[WHITE] >> pos) & 1 ? WHITE : BLACK;
+}
 
-bool Board::inbound(uint_fast8_t pos)
+template <int W, int H>
+Piece BasicBoard<W, H>::piece_at(uint_fast8_t pos) const
 {
-	return 0 <= pos && pos < BOARD_SIZE;
+	const bitmap_t mask = bit(pos);
+	const Team t = team_at(pos);
+	const bitboard_t *p = this->pieces[t];
+
+	if (!(this->team_bitmaps[t] & mask)) {
+		return EMPTY;
+	}
+	// assemble the type from its bits, KING = 0 so only the set bits need to be tested
+	const int type = (((p[MEDIC] | p[ARCHER] | p[SHIELD]) & mask) != 0)
+		| ((((p[WIZARD] | p[ARCHER]) & mask) != 0) << 1)
+		| ((((p[KNIGHT] | p[SHIELD]) & mask) != 0) << 2);
+	return static_cast<Piece>(type);
 }
 
-void Board::compute_team_bitmaps()
+template <int W, int H>
+void BasicBoard<W, H>::compute_team_bitmaps()
 {
 	for (int j = 0; j < NUM_TEAMS; ++j) {
 		this->team_bitmaps[j] = 0;
@@ -119,40 +166,177 @@ void Board::compute_team_bitmaps()
 
 }
 
-void Board::update_activity(uint_fast8_t pos)
+template <int W, int H>
+uint_fast64_t BasicBoard<W, H>::tile_key(uint_fast8_t pos) const
+{
+	const uint_fast8_t hp = hp_at(pos);
+	if (hp <= 0) {
+		return 0;
+	}
+	return this->lookup.zobrist_tiles[team_at(pos)][piece_at(pos)][hp][pos];
+}
+
+template <int W, int H>
+void BasicBoard<W, H>::compute_key()
+{
+	this->zobrist = 0;
+	for (uint_fast8_t pos = 0; pos < SIZE; ++pos) {
+		this->zobrist ^= tile_key(pos);
+	}
+	for (int t = 0; t < NUM_TEAMS; ++t) {
+		this->zobrist ^= this->lookup.zobrist_passes[t][this->passes[t]];
+	}
+	if (this->state == ACTION) {
+		this->zobrist ^= this->lookup.zobrist_action;
+	}
+	if (this->to_play == WHITE) {
+		this->zobrist ^= this->lookup.zobrist_white;
+	}
+}
+
+template <int W, int H>
+int_fast16_t BasicBoard<W, H>::tile_eval(uint_fast8_t pos) const
+{
+	const uint_fast8_t hp = hp_at(pos);
+	if (hp <= 0) {
+		return 0;
+	}
+
+	const Team t = team_at(pos);
+	const int_fast16_t a = (this->active[t] >> pos) & 1;
+	const int_fast16_t n = popcount(this->team_bitmaps[t] & this->lookup.neighbours[pos]);
+	// (active ? 1.5 : 1) * hp + 0.5 * friendly neighbours, doubled
+	const int_fast16_t value = eval_weights[piece_at(pos)] * ((2 + a) * hp + n);
+
+	return t == BLACK ? value : -value;
+}
+
+template <int W, int H>
+int_fast16_t BasicBoard<W, H>::tiles_eval(bitmap_t mask) const
+{
+	int_fast16_t value = 0;
+	while (mask) {
+		uint_fast8_t loc = ffs(mask) - 1;
+		mask &= mask - 1;
+		value += tile_eval(loc);
+	}
+	return value;
+}
+
+template <int W, int H>
+int_fast16_t BasicBoard<W, H>::weights(bitmap_t mask) const
+{
+	int_fast16_t value = 0;
+	while (mask) {
+		uint_fast8_t loc = ffs(mask) - 1;
+		mask &= mask - 1;
+		value += eval_weights[piece_at(loc)];
+	}
+	return value;
+}
+
+template <int W, int H>
+int_fast16_t BasicBoard<W, H>::swap_eval(uint_fast8_t pos1, uint_fast8_t pos2) const
+{
+	const bitmap_t bitmap_pos1 = bit(pos1);
+	const bitmap_t bitmap_pos2 = bit(pos2);
+	const Team t1 = team_at(pos1);
+	const Team t2 = team_at(pos2);
+	const int_fast16_t w1 = eval_weights[piece_at(pos1)];
+	const int_fast16_t w2 = eval_weights[piece_at(pos2)];
+	const int_fast16_t hp1 = hp_at(pos1);
+	const int_fast16_t hp2 = hp_at(pos2);
+	const int_fast16_t a1 = (this->active[t1] >> pos1) & 1;
+	const int_fast16_t a2 = (this->active[t2] >> pos2) & 1;
+
+	if (t1 == t2) {
+		// the pieces trade their activity and neighbour counts
+		const int_fast16_t n1 = popcount(this->team_bitmaps[t1] & this->lookup.neighbours[pos1]);
+		const int_fast16_t n2 = popcount(this->team_bitmaps[t1] & this->lookup.neighbours[pos2]);
+		const int_fast16_t value = (w1 - w2) * (n2 - n1) + (a1 - a2) * (w2 * hp2 - w1 * hp1);
+		return t1 == BLACK ? value : -value;
+	}
+
+	// each piece loses its activity, which update_activity gives back, and its friendly edges
+	// at the old position are replaced by the ones at the new position, a friendly edge is
+	// worth the weights of both its ends
+	const bitmap_t old1 = this->team_bitmaps[t1] & this->lookup.neighbours[pos1];
+	const bitmap_t new1 = this->team_bitmaps[t1] & this->lookup.neighbours[pos2] & ~bitmap_pos1;
+	const bitmap_t old2 = this->team_bitmaps[t2] & this->lookup.neighbours[pos2];
+	const bitmap_t new2 = this->team_bitmaps[t2] & this->lookup.neighbours[pos1] & ~bitmap_pos2;
+
+	const int_fast16_t value1 = -a1 * w1 * hp1 + w1 * (popcount(new1) - popcount(old1)) + weights(new1) - weights(old1);
+	const int_fast16_t value2 = -a2 * w2 * hp2 + w2 * (popcount(new2) - popcount(old2)) + weights(new2) - weights(old2);
+	return t1 == BLACK ? value1 - value2 : value2 - value1;
+}
+
+template <int W, int H>
+void BasicBoard<W, H>::compute_eval()
+{
+	this->score = tiles_eval(this->team_bitmaps[BLACK] | this->team_bitmaps[WHITE]);
+}
+
+template <int W, int H>
+void BasicBoard<W, H>::update_isolated(Team t)
+{
+	this->status &= ~STATUS_ISOLATED(t);
+	this->status |= (this->active[t] == 0) << t;
+}
+
+template <int W, int H>
+void BasicBoard<W, H>::compute_status()
+{
+	this->status = 0;
+	for (int t = 0; t < NUM_TEAMS; ++t) {
+		this->status |= (this->active[t] == 0) * STATUS_ISOLATED(t)
+			| (this->pieces[t][KING] == 0) * STATUS_KING_DEAD(t)
+			| (this->passes[t] > 2) * STATUS_SURRENDERED(t);
+	}
+}
+
+template <int W, int H>
+void BasicBoard<W, H>::update_activity(uint_fast8_t pos)
 {
 	assert(inbound(pos));
 
-	if (this->info[pos].hp <= 0) {
+	const uint_fast8_t hp = hp_at(pos);
+	if (hp <= 0) {
 		return;
 	}
 
-	const Team t = this->info[pos].team;
+	const Team t = team_at(pos);
 	// will be 1 if active and 0 otherwise
-	const uint_fast16_t a = (this->team_bitmaps[t] & this->lookup.neighbours[pos]) != 0;
-	this->info[pos].active = a;
+	const bitmap_t a = (this->team_bitmaps[t] & this->lookup.neighbours[pos]) != 0;
+	const bitmap_t was = (this->active[t] >> pos) & 1;
+	if (a == was) {
+		return;
+	}
 	// unset pos bit and set pos bit to be a
-	this->active[t] &= ~(1 << pos);
+	this->active[t] &= ~bit(pos);
 	this->active[t] |= a << pos;
+	update_isolated(t);
+
+	// activity is worth an extra half point per hp
+	const int_fast16_t delta = eval_weights[piece_at(pos)] * hp;
+	this->score += (a ? delta : -delta) * (t == BLACK ? 1 : -1);
 }
 
-void Board::update_all_activity()
+template <int W, int H>
+void BasicBoard<W, H>::update_all_activity()
 {
-	for (uint_fast8_t pos = 0; pos < BOARD_SIZE; ++pos) {
+	for (uint_fast8_t pos = 0; pos < SIZE; ++pos) {
 		update_activity(pos);
 	}
 }
 
-Board::Board()
+template <int W, int H>
+BasicBoard<W, H>::BasicBoard()
 {
-	for (int i = 0; i < BOARD_SIZE; ++i) {
-		this->info[i].hp = 0;
-	}
-
 	for (int j = 0; j < NUM_TEAMS; ++j) {
 		for (int i = 0; i < NUM_PIECES; ++i) {
 			this->pieces[j][i] = 0;
 		}
+		this->team_bitmaps[j] = 0;
 		this->active[j] = 0;
 		this->passes[j] = 0;
 	}
@@ -161,6 +345,12 @@ Board::Board()
 	this->state = SWAP;
 	this->turn_count = 0;
 	this->damaged = 0;
+	for (int i = 0; i < HP_WORDS; ++i) {
+		this->hp[i] = 0;
+	}
+	this->zobrist = 0;
+	this->score = 0;
+	compute_status();
 }
 
 Team char2team(char c)
@@ -227,7 +417,8 @@ int piece_max_hp(Piece p)
 	return out;
 }
 
-bool Board::load_file(std::string &filename)
+template <int W, int H>
+bool BasicBoard<W, H>::load_file(std::string &filename)
 {
 	std::string line;
 	std::ifstream f(filename);
@@ -274,7 +465,7 @@ bool Board::load_file(std::string &filename)
 	// set board pieces
 	uint_fast8_t i;
 	for (i = 0; getline(f >> std::ws, line, ';'); ++i) {
-		if (i >= BOARD_SIZE) {
+		if (i >= SIZE) {
 			return false;
 		}
 		if (line.size() == 1 && line[0] == '.') {
@@ -294,49 +485,89 @@ bool Board::load_file(std::string &filename)
 		}
 	}
 	update_all_activity();
+	compute_key();
+	compute_eval();
+	compute_status();
 
 	return true;
 }
 
-uint_fast128_t Board::hash()
+/* Description: sets the width bits of h starting at offset to the low bits of value, the bits
+ * 		must be clear.
+ * Args: h - the packed state to write to.
+ * 	 offset - the position of the lowest bit to write.
+ * 	 width - the number of bits to write, at most 32.
+ * 	 value - the value to write.
+ */
+static void pack_bits(uint_fast128_t &h, int offset, int width, uint64_t value)
+{
+	h |= (uint_fast128_t)(value & ((1ULL << width) - 1)) << offset;
+}
+
+template <size_t N>
+static void pack_bits(std::array<uint64_t, N> &h, int offset, int width, uint64_t value)
+{
+	value &= (1ULL << width) - 1;
+	h[offset / 64] |= value << (offset % 64);
+	// the value straddles two words
+	if (offset % 64 + width > 64) {
+		h[offset / 64 + 1] |= value >> (64 - offset % 64);
+	}
+}
+
+/* Description: returns the width bits of h starting at offset.
+ * Args: h - the packed state to read from.
+ * 	 offset - the position of the lowest bit to read.
+ * 	 width - the number of bits to read, at most 32.
+ */
+static uint64_t unpack_bits(const uint_fast128_t &h, int offset, int width)
+{
+	return (uint64_t)(h >> offset) & ((1ULL << width) - 1);
+}
+
+template <size_t N>
+static uint64_t unpack_bits(const std::array<uint64_t, N> &h, int offset, int width)
+{
+	uint64_t value = h[offset / 64] >> (offset % 64);
+	if (offset % 64 + width > 64) {
+		value |= h[offset / 64 + 1] << (64 - offset % 64);
+	}
+	return value & ((1ULL << width) - 1);
+}
+
+template <int W, int H>
+typename BasicBoard<W, H>::hash_t BasicBoard<W, H>::hash()
 {
-	uint_fast128_t state = 0;
+	hash_t state{};
 	const int offset = 7;
-	for (int i = 0; i < BOARD_SIZE; ++i) {
-		auto &tile = this->info[i];
-		int team = tile.team & 0x1;
-		int hp = tile.hp & 0x7;
-		int type = tile.type & 0x7;
-		state |= ((uint_fast128_t)((team << 6) | (hp << 3) | type)) << (offset * i);
-	}
-
-	state |= ((uint_fast128_t)this->state) << (offset * BOARD_SIZE);
-	state |= ((uint_fast128_t)this->to_play) << (offset * BOARD_SIZE + 1);
-	state |= ((uint_fast128_t)this->passes[BLACK]) << (offset * BOARD_SIZE + 2);
-	state |= ((uint_fast128_t)this->passes[WHITE]) << (offset * BOARD_SIZE + 4);
-	// last 10 bits to store quarter turns	
-	state |= ((uint_fast128_t)this->turn_count) << (offset * BOARD_SIZE + 6);
-
-	/*
-	std::cout << std::hex
-		<< (int)((state >> 96) & 0xffffffff)
-		<< (int)((state >> 64) & 0xffffffff)
-		<< (int)((state >> 32) & 0xffffffff)
-		<< (int)(state & 0xffffffff)
-		<< std::endl;
-	*/
+	for (int i = 0; i < SIZE; ++i) {
+		const piece_stats stats = tile(i);
+		int team = stats.team & 0x1;
+		int hp = stats.hp & 0x7;
+		int type = stats.type & 0x7;
+		pack_bits(state, offset * i, offset, (team << 6) | (hp << 3) | type);
+	}
+
+	pack_bits(state, offset * SIZE, 1, this->state);
+	pack_bits(state, offset * SIZE + 1, 1, this->to_play);
+	pack_bits(state, offset * SIZE + 2, 2, this->passes[BLACK]);
+	pack_bits(state, offset * SIZE + 4, 2, this->passes[WHITE]);
+	// last 10 bits to store quarter turns
+	pack_bits(state, offset * SIZE + 6, 10, this->turn_count);
+
 	return state;
 }
 
-bool Board::load_hash(uint_fast128_t state)
+template <int W, int H>
+bool BasicBoard<W, H>::load_hash(hash_t state)
 {
 	const int offset = 7;
-	for (int i = 0; i < BOARD_SIZE; ++i) {
-		Piece p = (Piece)(state & 0x7);
-		int hp = (state >> 3) & 0x7;
-		Team t = (Team)((state >> 6) & 0x1);
+	for (int i = 0; i < SIZE; ++i) {
+		const uint64_t stats = unpack_bits(state, offset * i, offset);
+		Piece p = (Piece)(stats & 0x7);
+		int hp = (stats >> 3) & 0x7;
+		Team t = (Team)((stats >> 6) & 0x1);
 		int max_hp = piece_max_hp(p);
-		//std::cout << t << " " << p << " " << hp << " " << max_hp << std::endl;
 		if (hp > max_hp | p == NUM_PIECES) {
 			return false;
 		}
@@ -345,35 +576,89 @@ bool Board::load_hash(uint_fast128_t state)
 		} else {
 			this->place_piece(p, t, hp, max_hp, i);
 		}
-		state >>= offset;
 	}
 
-	this->state = (Turn_T)(state & 0x1);
-	this->to_play = (Team)((state >> 1) & 0x1);
-	this->passes[BLACK] = (state >> 2) & 0x3;
-	this->passes[BLACK] = (state >> 4) & 0x3;
-	this->turn_count = state >> 6;
+	this->state = (Turn_T)unpack_bits(state, offset * SIZE, 1);
+	this->to_play = (Team)unpack_bits(state, offset * SIZE + 1, 1);
+	this->passes[BLACK] = unpack_bits(state, offset * SIZE + 2, 2);
+	this->passes[WHITE] = unpack_bits(state, offset * SIZE + 4, 2);
+	this->turn_count = unpack_bits(state, offset * SIZE + 6, 10);
 
 	if (this->passes[BLACK] > 2 || this->passes[WHITE] > 2) {
 		return false;
 	}
 
 	update_all_activity();
+	compute_key();
+	compute_eval();
+	compute_status();
 
 	return true;
 }
 
-int Board::get_passes(Team t)
+template <int W, int H>
+uint_fast64_t BasicBoard<W, H>::key()
+{
+	return this->zobrist;
+}
+
+template <int W, int H>
+int_fast16_t BasicBoard<W, H>::eval() const
+{
+	return this->score;
+}
+
+template <int W, int H>
+bool BasicBoard<W, H>::kills(const action &a) const
+{
+	if (a.pos == SIZE) {
+		return false;
+	}
+
+	switch (piece_at(a.pos)) {
+		case KING:
+		case ARCHER:
+		case KNIGHT:
+			// every attack does one damage to each target
+			for (bitmap_t trgts = a.trgts; trgts; trgts &= trgts - 1) {
+				if (hp_at(ffs(trgts) - 1) == 1) {
+					return true;
+				}
+			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+template <int W, int H>
+bool BasicBoard<W, H>::saves(const action &a) const
+{
+	if (a.pos == SIZE || piece_at(a.pos) != MEDIC) {
+		return false;
+	}
+
+	for (bitmap_t trgts = a.trgts; trgts; trgts &= trgts - 1) {
+		if (hp_at(ffs(trgts) - 1) == 1) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template <int W, int H>
+int BasicBoard<W, H>::get_passes(Team t)
 {
 	assert(t != NUM_TEAMS || t != NONE);
 	return this->passes[t];
 }
 
-int Board::num_friendly_neighbours(uint_fast8_t pos)
+template <int W, int H>
+int BasicBoard<W, H>::num_friendly_neighbours(uint_fast8_t pos)
 {
 	assert(inbound(pos));
-	const Team t = this->info[pos].team;
-	uint_fast16_t f = this->team_bitmaps[t] & this->lookup.neighbours[pos];
+	const Team t = team_at(pos);
+	bitmap_t f = this->team_bitmaps[t] & this->lookup.neighbours[pos];
 	int count = 0;
 	while (f) {
 		f = f & (f - 1);
@@ -382,40 +667,57 @@ int Board::num_friendly_neighbours(uint_fast8_t pos)
 	return count;
 }
 
-void Board::place_piece(Piece type, Team colour, uint_fast8_t hp, uint_fast8_t max_hp, uint_fast8_t pos)
+template <int W, int H>
+void BasicBoard<W, H>::place_piece(Piece type, Team colour, uint_fast8_t hp, uint_fast8_t max_hp, uint_fast8_t pos)
 {
 	assert(type != NUM_PIECES);
 	assert(colour != NUM_TEAMS);
 	assert(inbound(pos));
+	assert(hp <= 0 || max_hp == piece_max_hp(type));
+	// remove the previous occupant of the tile
+	if (hp_at(pos) > 0) {
+		this->zobrist ^= tile_key(pos);
+		this->pieces[team_at(pos)][piece_at(pos)] &= ~bit(pos);
+		this->active[team_at(pos)] &= ~bit(pos);
+	}
+	this->damaged &= ~bit(pos);
 	// set the piece on the corresponding bitboard
 	if (hp > 0) {
-		this->pieces[colour][type] |= 1 << pos;
+		this->pieces[colour][type] |= bit(pos);
 	}
+	compute_team_bitmaps();
 
-	this->info[pos].hp = hp;
-	this->info[pos].max_hp = max_hp;
-	this->info[pos].team = colour;
-	this->info[pos].type = type;
-	this->info[pos].active = false;
+	set_hp(pos, hp);
+	this->zobrist ^= tile_key(pos);
 
-	const uint_fast16_t d = hp > 0 && hp < max_hp;
+	const bitmap_t d = hp > 0 && hp < max_hp;
 	this->damaged |= d << pos;
 
-	compute_team_bitmaps();
+	compute_eval();
+	compute_status();
 }
 
-void Board::swap(uint_fast8_t pos1, uint_fast8_t pos2)
+template <int W, int H>
+void BasicBoard<W, H>::swap(uint_fast8_t pos1, uint_fast8_t pos2)
 {
 	assert(inbound(pos1));
 	assert(inbound(pos2));
+	assert(hp_at(pos1) > 0 && hp_at(pos2) > 0);
+
+	const bitmap_t bitmap_pos1 = bit(pos1);
+	const bitmap_t bitmap_pos2 = bit(pos2);
+
+	const Team t1 = team_at(pos1);
+	const Team t2 = team_at(pos2);
+	const Piece p1 = piece_at(pos1);
+	const Piece p2 = piece_at(pos2);
+	const uint_fast8_t hp1 = hp_at(pos1);
+	const uint_fast8_t hp2 = hp_at(pos2);
 
-	const uint_fast16_t bitmap_pos1 = 1 << pos1;
-	const uint_fast16_t bitmap_pos2 = 1 << pos2;
+	this->zobrist ^= this->lookup.zobrist_tiles[t1][p1][hp1][pos1] ^ this->lookup.zobrist_tiles[t2][p2][hp2][pos2]
+		^ this->lookup.zobrist_tiles[t1][p1][hp1][pos2] ^ this->lookup.zobrist_tiles[t2][p2][hp2][pos1];
 
-	const Team t1 = this->info[pos1].team;
-	const Team t2 = this->info[pos2].team;
-	const Piece p1 = this->info[pos1].type;
-	const Piece p2 = this->info[pos2].type;
+	this->score += swap_eval(pos1, pos2);
 
 	// if the team and piece type are the same don't need to do anything
 	if (t1 != t2 || p1 != p2) {
@@ -425,131 +727,340 @@ void Board::swap(uint_fast8_t pos1, uint_fast8_t pos2)
 		// unset bit at pos2 and set bit at pos1
 		this->pieces[t2][p2] &= ~bitmap_pos2;
 		this->pieces[t2][p2] |= bitmap_pos1;
+	}
+	if (t1 != t2) {
+		// each team moves from one position to the other
+		this->team_bitmaps[t1] ^= bitmap_pos1 | bitmap_pos2;
+		this->team_bitmaps[t2] ^= bitmap_pos1 | bitmap_pos2;
 		// unset activity
 		this->active[t1] &= ~bitmap_pos1;
 		this->active[t2] &= ~bitmap_pos2;
 	}
 	// swap damaged flags
-	const uint_fast16_t d1 = (this->damaged >> pos1) & 1;
-	const uint_fast16_t d2 = (this->damaged >> pos2) & 1;
+	const bitmap_t d1 = (this->damaged >> pos1) & 1;
+	const bitmap_t d2 = (this->damaged >> pos2) & 1;
 	this->damaged &= ~bitmap_pos1;
 	this->damaged &= ~bitmap_pos2;
 	this->damaged |= d1 << pos2;
 	this->damaged |= d2 << pos1;
 
-	std::swap(this->info[pos1], this->info[pos2]);
+	set_hp(pos1, hp2);
+	set_hp(pos2, hp1);
 
-	// recompute team_bitmaps since board state has changed
-	compute_team_bitmaps();
+	// swapping within a team leaves the team bitmaps and so the activity unchanged
+	if (t1 == t2) {
+		return;
+	}
 
 	// update active bitmap
-	uint_fast16_t loc2update = this->lookup.neighbours[pos1] | this->lookup.neighbours[pos2] | bitmap_pos1 | bitmap_pos2;
+	bitmap_t loc2update = this->lookup.neighbours[pos1] | this->lookup.neighbours[pos2] | bitmap_pos1 | bitmap_pos2;
 
 	while (loc2update) {
 		// find first bit location
 		uint_fast8_t loc = ffs(loc2update) - 1;
 		// remove loc
-		loc2update &= ~(1 << loc);
+		loc2update &= ~bit(loc);
 		update_activity(loc);
 	}
+	// the cleared activity of the swapped pieces isn't necessarily given back
+	update_isolated(t1);
+	update_isolated(t2);
 
 }
 
-void Board::apply_swap(uint_fast8_t pos1, uint_fast8_t pos2)
+template <int W, int H>
+void BasicBoard<W, H>::apply_swap(uint_fast8_t pos1, uint_fast8_t pos2)
 {
 	assert(this->state == SWAP);
 
 	swap(pos1, pos2);
 	this->state = ACTION;
 	this->turn_count += 1;
+	this->zobrist ^= this->lookup.zobrist_action;
 }
 
-void Board::apply_action(action &a)
+template <int W, int H>
+template <Team T>
+void BasicBoard<W, H>::apply_action_for(const action &a)
 {
-	assert(this->state == ACTION);
+	assert(this->state == ACTION && this->to_play == T);
 
-	Team other_team = static_cast<Team>(1 - this->to_play);
+	constexpr Team other_team = static_cast<Team>(1 - T);
+	const uint_fast64_t *passes_key = this->lookup.zobrist_passes[T];
 
-	if (a.pos == BOARD_SIZE && a.num_trgts == 0) {
+	this->zobrist ^= passes_key[this->passes[T]];
+
+	if (a.pos == SIZE && a.trgts == 0) {
 		// skip action
-		this->passes[this->to_play] += 1;
+		this->passes[T] += 1;
 	} else {
 		assert(inbound(a.pos));
-		assert(this->to_play == this->info[a.pos].team);
-
-		for (int i = 0; i < a.num_trgts; ++i) {
-			assert(inbound(a.trgts[i]));
-		}
+		assert(T == team_at(a.pos));
 
-		const Piece p = this->info[a.pos].type;
-		uint_fast16_t update = 0;
-		piece_stats *stats;
+		const Piece p = piece_at(a.pos);
+		bitmap_t trgts = a.trgts;
+		bitmap_t update = 0;
+		int_fast16_t delta;
+		uint_fast8_t trgt, hp;
+		Piece type;
 
 		switch (p) {
 			case KING:
 			case ARCHER:
 			case KNIGHT:
-				for (int i = 0; i < a.num_trgts; ++i) {
-					stats = &(this->info[a.trgts[i]]);
-					stats->hp -= 1;
-					this->damaged &= ~(1 << a.trgts[i]);
-					if (stats->hp > 0) {
-						this->damaged |= 1 << a.trgts[i];
+				while (trgts) {
+					trgt = ffs(trgts) - 1;
+					trgts &= trgts - 1;
+					type = piece_at(trgt);
+					hp = hp_at(trgt) - 1;
+					this->zobrist ^= this->lookup.zobrist_tiles[other_team][type][hp + 1][trgt]
+						^ this->lookup.zobrist_tiles[other_team][type][hp][trgt];
+					// a kill also takes a neighbour away from the target's teammates
+					delta = hp > 0 ? eval_weights[type] * (2 + ((this->active[other_team] >> trgt) & 1))
+						: tile_eval(trgt) * (other_team == BLACK ? 1 : -1)
+							+ weights(this->lookup.neighbours[trgt] & this->team_bitmaps[other_team]);
+					this->score -= other_team == BLACK ? delta : -delta;
+					set_hp(trgt, hp);
+					this->damaged &= ~bit(trgt);
+					if (hp > 0) {
+						this->damaged |= bit(trgt);
 					} else {
 						// piece is dead, remove from pieces, team, and active bitmap
 						// add neighbours who are teammates to update bitmap
-						this->pieces[stats->team][stats->type] &= ~(1 << a.trgts[i]);
-						this->team_bitmaps[other_team] &= ~(1 << a.trgts[i]);
-						this->active[other_team] &= ~(1 << a.trgts[i]);
-						update |= this->lookup.neighbours[a.trgts[i]] & this->team_bitmaps[other_team];
+						this->pieces[other_team][type] &= ~bit(trgt);
+						this->team_bitmaps[other_team] &= ~bit(trgt);
+						this->active[other_team] &= ~bit(trgt);
+						update |= this->lookup.neighbours[trgt] & this->team_bitmaps[other_team];
+						if (type == KING) {
+							this->status |= STATUS_KING_DEAD(other_team);
+						}
 					}
 				}
 				// update activity
 				while (update) {
 					uint_fast8_t loc = ffs(update) - 1;
-					update &= ~(1 << loc);
+					update &= ~bit(loc);
 					update_activity(loc);
 				}
+				update_isolated(other_team);
 				break;
 			case MEDIC:
-				for (int i = 0; i < a.num_trgts; ++i) {
-					stats = &(this->info[a.trgts[i]]);
-					stats->hp += 1;
-					if (stats->hp >= stats->max_hp) {
-						this->damaged &= ~(1 << a.trgts[i]);
+				while (trgts) {
+					trgt = ffs(trgts) - 1;
+					trgts &= trgts - 1;
+					type = piece_at(trgt);
+					hp = hp_at(trgt) + 1;
+					this->zobrist ^= this->lookup.zobrist_tiles[T][type][hp - 1][trgt]
+						^ this->lookup.zobrist_tiles[T][type][hp][trgt];
+					delta = eval_weights[type] * (2 + ((this->active[T] >> trgt) & 1));
+					this->score += T == BLACK ? delta : -delta;
+					set_hp(trgt, hp);
+					if (hp >= piece_max_hp(type)) {
+						this->damaged &= ~bit(trgt);
 					}
 				}
 				break;
 			case WIZARD:
-				swap(a.pos, a.trgts[0]);
+				swap(a.pos, ffs(a.trgts) - 1);
 				break;
-			case SHIELD:
+			default:
 				assert(0);
 		}
-		this->passes[this->to_play] = 0;
+		this->passes[T] = 0;
 	}
+	this->zobrist ^= passes_key[this->passes[T]];
+	this->status &= ~STATUS_SURRENDERED(T);
+	this->status |= (this->passes[T] > 2) * STATUS_SURRENDERED(T);
 	// update game state
 	this->state = SWAP;
 	this->turn_count += 1;
 	this->to_play = other_team;
+	this->zobrist ^= this->lookup.zobrist_action ^ this->lookup.zobrist_white;
 }
 
-void Board::generate_swaps_at(
-		uint_fast8_t pos, 
-		std::vector<std::pair<uint_fast8_t, 
-		uint_fast8_t>> &swaps, int seen[BOARD_SIZE][BOARD_SIZE])
+template <int W, int H>
+void BasicBoard<W, H>::apply_action(const action &a)
+{
+	if (this->to_play == BLACK) {
+		apply_action_for<BLACK>(a);
+	} else {
+		apply_action_for<WHITE>(a);
+	}
+}
+
+template <int W, int H>
+typename BasicBoard<W, H>::undo BasicBoard<W, H>::make_swap(uint_fast8_t pos1, uint_fast8_t pos2)
+{
+	undo u;
+	u.move.swap.first = pos1;
+	u.move.swap.second = pos2;
+	u.state = this->state;
+	u.to_play = this->to_play;
+	u.actor = EMPTY;
+	u.passes = this->passes[this->to_play];
+	u.zobrist = this->zobrist;
+	u.score = this->score;
+	u.status = this->status;
+
+	apply_swap(pos1, pos2);
+
+	return u;
+}
+
+template <int W, int H>
+template <Team T>
+typename BasicBoard<W, H>::undo BasicBoard<W, H>::make_action_for(const action &a)
+{
+	undo u;
+	u.move.act = a;
+	u.state = ACTION;
+	u.to_play = T;
+	u.actor = a.pos < SIZE ? piece_at(a.pos) : EMPTY;
+	bitmap_t trgts = a.trgts;
+	for (int i = 0; trgts; ++i) {
+		u.trgt_types[i] = piece_at(ffs(trgts) - 1);
+		trgts &= trgts - 1;
+	}
+	u.passes = this->passes[T];
+	u.zobrist = this->zobrist;
+	u.score = this->score;
+	u.status = this->status;
+
+	apply_action_for<T>(a);
+
+	return u;
+}
+
+template <int W, int H>
+typename BasicBoard<W, H>::undo BasicBoard<W, H>::make_action(const action &a)
+{
+	if (this->to_play == BLACK) {
+		return make_action_for<BLACK>(a);
+	}
+	return make_action_for<WHITE>(a);
+}
+
+template <int W, int H>
+template <Turn_T S, Team T>
+typename BasicBoard<W, H>::undo BasicBoard<W, H>::make_move_for(const MoveChoice &m)
+{
+	assert(this->state == S && this->to_play == T);
+
+	if constexpr (S == SWAP) {
+		return make_swap(m.swap.first, m.swap.second);
+	} else {
+		return make_action_for<T>(m.act);
+	}
+}
+
+template <int W, int H>
+typename BasicBoard<W, H>::undo BasicBoard<W, H>::make_move(const MoveChoice &m)
+{
+	if (this->state == SWAP) {
+		return make_swap(m.swap.first, m.swap.second);
+	}
+	return make_action(m.act);
+}
+
+template <int W, int H>
+template <Turn_T S, Team T>
+void BasicBoard<W, H>::unmake_for(const undo &u)
+{
+	assert(u.state == S && u.to_play == T);
+
+	if constexpr (S == SWAP) {
+		// swaps are their own inverse
+		swap(u.move.swap.first, u.move.swap.second);
+	} else {
+		const action &a = u.move.act;
+		constexpr Team other_team = static_cast<Team>(1 - T);
+		bitmap_t trgts = a.trgts;
+		bitmap_t update = 0;
+		uint_fast8_t trgt, hp;
+
+		switch (u.actor) {
+			case KING:
+			case ARCHER:
+			case KNIGHT:
+				for (int i = 0; trgts; ++i) {
+					trgt = ffs(trgts) - 1;
+					trgts &= trgts - 1;
+					hp = hp_at(trgt);
+					if (hp <= 0) {
+						// revive the piece
+						this->pieces[other_team][u.trgt_types[i]] |= bit(trgt);
+						this->team_bitmaps[other_team] |= bit(trgt);
+						update |= (this->lookup.neighbours[trgt] & this->team_bitmaps[other_team]) | bit(trgt);
+					}
+					set_hp(trgt, hp + 1);
+					this->damaged &= ~bit(trgt);
+					this->damaged |= (bitmap_t)(hp + 1 < piece_max_hp(u.trgt_types[i])) << trgt;
+				}
+				while (update) {
+					uint_fast8_t loc = ffs(update) - 1;
+					update &= ~bit(loc);
+					update_activity(loc);
+				}
+				break;
+			case MEDIC:
+				while (trgts) {
+					trgt = ffs(trgts) - 1;
+					trgts &= trgts - 1;
+					set_hp(trgt, hp_at(trgt) - 1);
+					this->damaged |= bit(trgt);
+				}
+				break;
+			case WIZARD:
+				swap(a.pos, ffs(a.trgts) - 1);
+				break;
+			default:
+				// skip action
+				break;
+		}
+		this->passes[T] = u.passes;
+	}
+
+	this->state = S;
+	this->to_play = T;
+	this->turn_count -= 1;
+	this->zobrist = u.zobrist;
+	this->score = u.score;
+	this->status = u.status;
+}
+
+template <int W, int H>
+void BasicBoard<W, H>::unmake(const undo &u)
+{
+	if (u.state == SWAP) {
+		if (u.to_play == BLACK) {
+			unmake_for<SWAP, BLACK>(u);
+		} else {
+			unmake_for<SWAP, WHITE>(u);
+		}
+	} else if (u.to_play == BLACK) {
+		unmake_for<ACTION, BLACK>(u);
+	} else {
+		unmake_for<ACTION, WHITE>(u);
+	}
+}
+
+template <int W, int H>
+template <Team T>
+void BasicBoard<W, H>::generate_swaps_at(uint_fast8_t pos, SwapList &swaps, bitmap_t seen)
 {
 	assert(inbound(pos));
+	assert(T == team_at(pos));
 
-	Team other_team = static_cast<Team>(1 - this->info[pos].team);
-	const uint_fast16_t all_pieces = this->team_bitmaps[WHITE] | this->team_bitmaps[BLACK];
+	constexpr Team other_team = static_cast<Team>(1 - T);
+	const bitmap_t all_pieces = this->team_bitmaps[WHITE] | this->team_bitmaps[BLACK];
 
-	uint_fast16_t swapable = this->lookup.neighbours[pos] & (all_pieces ^ this->pieces[other_team][SHIELD]);
+	// swaps with positions already seen were generated from the other end
+	bitmap_t swapable = this->lookup.neighbours[pos] & (all_pieces ^ this->pieces[other_team][SHIELD]) & ~seen;
 	std::pair<uint_fast8_t, uint_fast8_t> edge;
 
 	while (swapable) {
 		uint_fast8_t loc = ffs(swapable) - 1;
-		swapable &= ~(1 << loc);
+		swapable &= ~bit(loc);
 
 		edge.first = pos;
 		edge.second = loc;
@@ -557,192 +1068,257 @@ void Board::generate_swaps_at(
 		if (pos > loc) {
 			std::swap(edge.first, edge.second);
 		}
-		if (!seen[edge.first][edge.second]) {
-			swaps.push_back(edge);
-			seen[edge.first][edge.second] = 1;
-		}
+		swaps.push_back(edge);
 	}
 }
 
-std::vector<std::pair<uint_fast8_t, uint_fast8_t>> Board::generate_swaps()
+template <int W, int H>
+template <Team T>
+void BasicBoard<W, H>::generate_swaps_for(SwapList &swaps)
 {
-	std::vector<std::pair<uint_fast8_t, uint_fast8_t>> swaps;
-	// at most 20 swaps per state
-	swaps.reserve(20);
+	assert(this->to_play == T);
 
-	int seen[BOARD_SIZE][BOARD_SIZE] = {0};
+	swaps.clear();
 
-	uint_fast16_t candidates = this->team_bitmaps[this->to_play] & this->active[this->to_play];
+	bitmap_t candidates = this->team_bitmaps[T] & this->active[T];
+	bitmap_t seen = 0;
 
 	while (candidates) {
 		uint_fast8_t loc = ffs(candidates) - 1;
-		candidates &= ~(1 << loc);
+		candidates &= ~bit(loc);
 
-		generate_swaps_at(loc, swaps, seen);
+		generate_swaps_at<T>(loc, swaps, seen);
+		seen |= bit(loc);
 	}
-
-	return swaps;
 }
 
-void Board::generate_actions_at(uint_fast8_t pos, std::vector<action> &actions)
+template <int W, int H>
+void BasicBoard<W, H>::generate_swaps(SwapList &swaps)
 {
-	assert(inbound(pos));
-
-	Piece p = this->info[pos].type;
-	Team t = this->info[pos].team;
-	Team other_team = static_cast<Team>(1 - this->info[pos].team);
-
-	int_fast8_t opp_shield;
-	uint_fast16_t trgts;
-	int k; // max number of targets
-
-	switch (p) {
-		case KING:
-			trgts = this->lookup.neighbours[pos] & this->team_bitmaps[other_team];
-			k = 1;
-			break;
-		case MEDIC:
-			trgts = this->lookup.neighbours[pos] & this->team_bitmaps[t] & this->damaged;
-			k = 4;
-			break;
-		case WIZARD:
-			trgts = this->team_bitmaps[t] ^ this->pieces[t][WIZARD];
-			k = 1;
-			break;
-		case ARCHER:
-			opp_shield = ffs(this->pieces[other_team][SHIELD]) - 1;
-			opp_shield = opp_shield >= 0 ? opp_shield : BOARD_SIZE;
-			trgts = this->lookup.archer_attacks[pos][opp_shield] & this->team_bitmaps[other_team];
-			k = 1;
-			break;
-		case KNIGHT:
-			trgts = this->lookup.neighbours[pos] & this->team_bitmaps[other_team];
-			k = 2;
-			break;
-		case SHIELD:
-			trgts = 0;
-			k = 0;
-			return;
+	if (this->to_play == BLACK) {
+		generate_swaps_for<BLACK>(swaps);
+	} else {
+		generate_swaps_for<WHITE>(swaps);
 	}
+}
+
+template <int W, int H>
+std::vector<std::pair<uint_fast8_t, uint_fast8_t>> BasicBoard<W, H>::generate_swaps()
+{
+	SwapList swaps;
+	generate_swaps(swaps);
 
-	std::vector<uint_fast8_t> trgt_pos;
+	return std::vector<std::pair<uint_fast8_t, uint_fast8_t>>(swaps.begin(), swaps.end());
+}
 
-	while (trgts) {
-		uint_fast8_t loc = ffs(trgts) - 1;
-		trgts &= ~(1 << loc);
-		trgt_pos.push_back(loc);
+template <int W, int H>
+template <Team T, Piece P>
+void BasicBoard<W, H>::generate_actions_at(uint_fast8_t pos, ActionList &actions)
+{
+	assert(inbound(pos));
+	assert(T == team_at(pos) && P == piece_at(pos));
+
+	constexpr Team other_team = static_cast<Team>(1 - T);
+	// max number of targets
+	constexpr int k = P == MEDIC ? 4 : P == KNIGHT ? 2 : 1;
+
+	bitmap_t trgts;
+	if constexpr (P == KING || P == KNIGHT) {
+		trgts = this->lookup.neighbours[pos] & this->team_bitmaps[other_team];
+	} else if constexpr (P == MEDIC) {
+		trgts = this->lookup.neighbours[pos] & this->team_bitmaps[T] & this->damaged;
+	} else if constexpr (P == WIZARD) {
+		trgts = this->team_bitmaps[T] ^ this->pieces[T][WIZARD];
+	} else {
+		static_assert(P == ARCHER, "shields have no actions");
+		int_fast8_t opp_shield = ffs(this->pieces[other_team][SHIELD]) - 1;
+		opp_shield = opp_shield >= 0 ? opp_shield : SIZE;
+		trgts = this->lookup.archer_attacks[pos][opp_shield] & this->team_bitmaps[other_team];
 	}
 
 	action act;
 	act.pos = pos;
 
-	if (k == 1) {
-		act.num_trgts = 1;
-		for (auto t: trgt_pos) {
-			act.trgts[0] = t;
+	if constexpr (k == 1) {
+		while (trgts) {
+			act.trgts = trgts & -trgts;
+			trgts &= trgts - 1;
 			actions.push_back(act);
 		}
 	} else {
-		for (int i = 1; i <= k; ++i) {
-			if (trgt_pos.size() < i)
-				break;
-			act.num_trgts = i;
-			for (auto &subset: this->lookup.n_k_subset[trgt_pos.size()-1][i-1]) {
-				for (int j = 0; j < i; ++j) {
-					act.trgts[j] = trgt_pos[subset[j]];
-				}
+		// every non empty sub mask of the targets with at most k targets, in increasing order
+		for (bitmap_t sub = trgts & -trgts; sub; sub = (sub - trgts) & trgts) {
+			if (popcount(sub) <= k) {
+				act.trgts = sub;
 				actions.push_back(act);
 			}
 		}
 	}
 }
 
-std::vector<action> Board::generate_actions()
+template <int W, int H>
+template <Team T>
+void BasicBoard<W, H>::generate_actions_for(ActionList &actions)
 {
-	std::vector<action> actions;
-	actions.reserve(21);
+	assert(this->to_play == T);
+
+	actions.clear();
 
 	// pieces on the active team except shield that are active
-	uint_fast16_t candidates = (this->team_bitmaps[this->to_play] ^ this->pieces[this->to_play][SHIELD])
-		& this->active[this->to_play];
+	bitmap_t candidates = (this->team_bitmaps[T] ^ this->pieces[T][SHIELD]) & this->active[T];
 
 	while (candidates) {
 		uint_fast8_t loc = ffs(candidates) - 1;
-		candidates &= ~(1 << loc);
+		candidates &= ~bit(loc);
 
-		generate_actions_at(loc, actions);
+		switch (piece_at(loc)) {
+			case KING:
+				generate_actions_at<T, KING>(loc, actions);
+				break;
+			case MEDIC:
+				generate_actions_at<T, MEDIC>(loc, actions);
+				break;
+			case WIZARD:
+				generate_actions_at<T, WIZARD>(loc, actions);
+				break;
+			case ARCHER:
+				generate_actions_at<T, ARCHER>(loc, actions);
+				break;
+			case KNIGHT:
+				generate_actions_at<T, KNIGHT>(loc, actions);
+				break;
+			default:
+				assert(0);
+		}
 	}
 
 	// skip action
-	actions.push_back(action{BOARD_SIZE, 0});
+	actions.push_back(action{SIZE, 0});
+}
 
-	return actions;
+template <int W, int H>
+void BasicBoard<W, H>::generate_actions(ActionList &actions)
+{
+	if (this->to_play == BLACK) {
+		generate_actions_for<BLACK>(actions);
+	} else {
+		generate_actions_for<WHITE>(actions);
+	}
 }
 
-std::vector<piece_stats> Board::tile_info()
+template <int W, int H>
+std::vector<typename BasicBoard<W, H>::action> BasicBoard<W, H>::generate_actions()
 {
-	return std::vector<piece_stats>(this->info, this->info + BOARD_SIZE);
+	ActionList actions;
+	generate_actions(actions);
+
+	return std::vector<action>(actions.begin(), actions.end());
 }
 
-bool Board::isolated(Team t)
+template <int W, int H>
+piece_stats BasicBoard<W, H>::tile(uint_fast8_t pos) const
+{
+	assert(inbound(pos));
+
+	piece_stats stats{0, 0, NONE, EMPTY, false};
+	const uint_fast8_t hp = hp_at(pos);
+
+	if (hp > 0) {
+		stats.hp = hp;
+		stats.team = team_at(pos);
+		stats.type = piece_at(pos);
+		stats.max_hp = piece_max_hp(stats.type);
+		stats.active = (this->active[stats.team] >> pos) & 1;
+	}
+
+	return stats;
+}
+
+template <int W, int H>
+std::vector<piece_stats> BasicBoard<W, H>::tile_info()
+{
+	piece_stats tiles[SIZE];
+
+	for (uint_fast8_t pos = 0; pos < SIZE; ++pos) {
+		tiles[pos] = piece_stats{0, 0, NONE, EMPTY, false};
+	}
+	// walk the bitboards rather than recovering the type of each tile
+	for (int t = 0; t < NUM_TEAMS; ++t) {
+		for (int p = 0; p < NUM_PIECES; ++p) {
+			bitmap_t bb = this->pieces[t][p];
+			while (bb) {
+				uint_fast8_t pos = ffs(bb) - 1;
+				bb &= ~bit(pos);
+				tiles[pos].hp = hp_at(pos);
+				tiles[pos].max_hp = piece_max_hp(static_cast<Piece>(p));
+				tiles[pos].team = static_cast<Team>(t);
+				tiles[pos].type = static_cast<Piece>(p);
+				tiles[pos].active = (this->active[t] >> pos) & 1;
+			}
+		}
+	}
+	return std::vector<piece_stats>(tiles, tiles + SIZE);
+}
+
+template <int W, int H>
+bool BasicBoard<W, H>::isolated(Team t)
 {
 	assert(t != NUM_TEAMS);
 
-	return this->active[t] == 0;
+	return this->status & STATUS_ISOLATED(t);
 }
 
-bool Board::king_dead(Team t)
+template <int W, int H>
+bool BasicBoard<W, H>::king_dead(Team t)
 {
 	assert(t != NUM_TEAMS);
 
-	return this->pieces[t][KING] == 0;
+	return this->status & STATUS_KING_DEAD(t);
 }
 
-bool Board::surrendered(Team t)
+template <int W, int H>
+bool BasicBoard<W, H>::surrendered(Team t)
 {
 	assert(t != NUM_TEAMS);
 
-	return this->passes[t] > 2;
+	return this->status & STATUS_SURRENDERED(t);
 }
 
-bool Board::gameover()
+template <int W, int H>
+bool BasicBoard<W, H>::gameover()
 {
-	const Team opponent = static_cast<Team>(1 - this->to_play);
-	return isolated(this->to_play) || isolated(opponent)
-		|| king_dead(this->to_play) || king_dead(opponent)
-		|| surrendered(this->to_play) || surrendered(opponent);
+	return this->status != 0;
 }
 
-std::pair<Team, Win_Condition> Board::winner()
+template <int W, int H>
+std::pair<Team, Win_Condition> BasicBoard<W, H>::winner()
 {
 	std::pair<Team, Win_Condition> out{NONE, NO_WINNER};
+	const uint_fast8_t s = this->status;
 
-	if (!this->gameover()) {
+	if (!s) {
 		return out;
 	}
 
-	const bool bi = this->isolated(BLACK);
-	const bool wi = this->isolated(WHITE);
-
-	if (this->surrendered(BLACK)) {
+	if (s & STATUS_SURRENDERED(BLACK)) {
 		out.first = WHITE;
 		out.second = SURRENDERED;
-	} else if (this->king_dead(BLACK)) {
+	} else if (s & STATUS_KING_DEAD(BLACK)) {
 		out.first = WHITE;
 		out.second = KING_DEAD;
-	} else if (this->surrendered(WHITE)) {
+	} else if (s & STATUS_SURRENDERED(WHITE)) {
 		out.first = BLACK;
 		out.second = SURRENDERED;
-	} else if (this->king_dead(WHITE)) {
+	} else if (s & STATUS_KING_DEAD(WHITE)) {
 		out.first = BLACK;
 		out.second = KING_DEAD;
-	} else if (bi && wi) {
+	} else if ((s & STATUS_ISOLATED(BLACK)) && (s & STATUS_ISOLATED(WHITE))) {
 		out.first = NONE;
 		out.second = ISOLATED;
-	} else if (bi) {
+	} else if (s & STATUS_ISOLATED(BLACK)) {
 		out.first = WHITE;
 		out.second = ISOLATED;
-	} else if (wi) {
+	} else {
 		out.first = BLACK;
 		out.second = ISOLATED;
 	}
@@ -750,17 +1326,18 @@ std::pair<Team, Win_Condition> Board::winner()
 	return out;
 }
 
-std::ostream &operator<<(std::ostream &os, const Board &b)
+template <int W, int H>
+std::ostream &operator<<(std::ostream &os, const BasicBoard<W, H> &b)
 {
-	for (int i = 0; i < BOARD_SIZE; ++i) {
-		piece_stats stats = b.info[i];
+	for (int i = 0; i < W * H; ++i) {
+		piece_stats stats = b.tile(i);
 		if (stats.hp > 0) {
 			os << "| " << stats.team << " " << stats.type << " " << (int)stats.hp << " "
 				<< (int)stats.max_hp << " " << (stats.active ? "*" : ".");
 		} else {
 			os << "| ..... . . . .";
 		}
-		if (i % BOARD_WIDTH == BOARD_WIDTH - 1) {
+		if (i % W == W - 1) {
 			os << "|\n";
 		}
 	}
@@ -841,3 +1418,26 @@ std::ostream &operator<<(std::ostream &os, const Win_Condition &w)
 
 	return os;
 }
+
+// instantiates a board size along with the specialisations of the member templates used outside
+// of this file, the search dispatches on the state and the team to play once per node rather
+// than once per board operation
+#define INSTANTIATE_BOARD(w, h) \
+	template class BasicBoard<w, h>; \
+	template BasicBoard<w, h>::undo BasicBoard<w, h>::make_move_for<SWAP, BLACK>(const MoveChoice &m); \
+	template BasicBoard<w, h>::undo BasicBoard<w, h>::make_move_for<SWAP, WHITE>(const MoveChoice &m); \
+	template BasicBoard<w, h>::undo BasicBoard<w, h>::make_move_for<ACTION, BLACK>(const MoveChoice &m); \
+	template BasicBoard<w, h>::undo BasicBoard<w, h>::make_move_for<ACTION, WHITE>(const MoveChoice &m); \
+	template void BasicBoard<w, h>::unmake_for<SWAP, BLACK>(const undo &u); \
+	template void BasicBoard<w, h>::unmake_for<SWAP, WHITE>(const undo &u); \
+	template void BasicBoard<w, h>::unmake_for<ACTION, BLACK>(const undo &u); \
+	template void BasicBoard<w, h>::unmake_for<ACTION, WHITE>(const undo &u); \
+	template void BasicBoard<w, h>::generate_swaps_for<BLACK>(SwapList &swaps); \
+	template void BasicBoard<w, h>::generate_swaps_for<WHITE>(SwapList &swaps); \
+	template void BasicBoard<w, h>::generate_actions_for<BLACK>(ActionList &actions); \
+	template void BasicBoard<w, h>::generate_actions_for<WHITE>(ActionList &actions); \
+	template std::ostream &operator<<(std::ostream &os, const BasicBoard<w, h> &b);
+
+INSTANTIATE_BOARD(4, 4)
+INSTANTIATE_BOARD(5, 5)
+INSTANTIATE_BOARD(6, 6)
@@ -1,26 +1,47 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <cassert>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <string>
 
+// dimensions of the standard board, other sizes are available through BasicBoard
 #define BOARD_WIDTH 4
 #define BOARD_HEIGHT 4
 #define BOARD_SIZE (BOARD_WIDTH * BOARD_HEIGHT)
 
+// a swap is an edge of the grid, so there are at most 24 on a 4x4 board
+#define MAX_SWAPS(w, h) (2 * (w) * (h) - (w) - (h))
+// bound on the actions of any loadable army, each tile contributes at most 15 actions (the
+// sub masks of a medic's 4 neighbours) or one per other tile (a wizard or an archer), plus the
+// skip action. 241 on a 4x4 board
+#define MAX_ACTIONS(w, h) ((w) * (h) * ((w) * (h) > 16 ? (w) * (h) - 1 : 15) + 1)
+// bits used by hash for a board of n tiles, 7 per tile followed by the state, the team to
+// play, the passes and 10 bits of turn count
+#define HASH_BITS(n) (7 * (n) + 16)
+
 #define uint_fast128_t unsigned __int128
 
-enum Team {
+// the running evaluation kept by Board is in units of 1 / EVAL_SCALE
+#define EVAL_SCALE 40
+
+// bits of the game over status kept by Board, for a team t = BLACK or WHITE
+#define STATUS_ISOLATED(t) (1 << (t))
+#define STATUS_KING_DEAD(t) (4 << (t))
+#define STATUS_SURRENDERED(t) (16 << (t))
+
+enum Team : uint8_t {
 	BLACK = 0,
 	WHITE = 1,
 	NUM_TEAMS,
 	NONE
 };
 
-enum Piece {
+enum Piece : uint8_t {
 	KING = 0,
 	MEDIC,
 	WIZARD,
@@ -31,7 +52,7 @@ enum Piece {
 	EMPTY
 };
 
-enum Turn_T {
+enum Turn_T : uint8_t {
 	SWAP = 0,
 	ACTION
 };
@@ -52,41 +73,89 @@ struct piece_stats {
 	bool active;
 };
 
-struct action {
-	uint_fast8_t pos; // location of action doer
-	uint_fast8_t num_trgts; // 1-4
-	uint_fast8_t trgts[4];
+/*
+ * Integer types with a bit for each of the n tiles of a board, type is used to
+ * store bitboards and fast to compute with them.
+ */
+template <int N>
+struct bitboard_types {
+	static_assert(N <= 64, "boards are limited to 64 tiles");
+
+	typedef std::conditional_t<N <= 16, uint16_t, std::conditional_t<N <= 32, uint32_t, uint64_t>> type;
+	typedef std::conditional_t<N <= 16, uint_fast16_t,
+		std::conditional_t<N <= 32, uint_fast32_t, uint_fast64_t>> fast;
+};
+
+/*
+ * Fixed capacity list of moves that lives on the stack, used so move
+ * generation does not allocate.
+ */
+template <typename T, size_t N>
+class MoveList {
+	T moves[N];
+	size_t count;
+
+	public:
+
+	MoveList(): count{0} {}
+
+	void push_back(const T &m)
+	{
+		assert(this->count < N);
+		this->moves[this->count++] = m;
+	}
+	void clear() { this->count = 0; }
+	size_t size() const { return this->count; }
+	bool empty() const { return this->count == 0; }
+
+	T &operator[](size_t i) { return this->moves[i]; }
+	const T &operator[](size_t i) const { return this->moves[i]; }
+	T *begin() { return this->moves; }
+	T *end() { return this->moves + this->count; }
+	const T *begin() const { return this->moves; }
+	const T *end() const { return this->moves + this->count; }
 };
 
+/*
+ * Tables used by move generation and hashing for a W x H board. They are computed
+ * at compile time by the constexpr constructor so they live in read only data.
+ */
+template <int W, int H>
 class LookupTables {
 	public:
+	static constexpr int SIZE = W * H;
+
+	typedef typename bitboard_types<SIZE>::fast bitmap_t;
+
 	// bitmap for each position representing neighbours of that tile
-	uint_fast16_t neighbours[BOARD_SIZE];
-	// archer attack lookup table, first index archer pos 0-15, second
-	// index the pos of enemy shield 0-15, 16 if no shield
-	uint_fast16_t archer_attacks[BOARD_SIZE][BOARD_SIZE+1];
-	// stores index of k element subsets of an array of length n,
-	// first index for array len, second for k element subset
-	std::vector<std::vector<uint_fast8_t>> n_k_subset[4][4];
+	bitmap_t neighbours[SIZE];
+	// archer attack lookup table, first index archer pos, second
+	// index the pos of enemy shield, SIZE if no shield
+	bitmap_t archer_attacks[SIZE][SIZE+1];
+	// zobrist keys for each piece of each team at each hp (1-4) and position
+	uint_fast64_t zobrist_tiles[NUM_TEAMS][NUM_PIECES][5][SIZE];
+	// zobrist keys for the ACTION state, WHITE to play, and passes (0-3) of each team
+	uint_fast64_t zobrist_action;
+	uint_fast64_t zobrist_white;
+	uint_fast64_t zobrist_passes[NUM_TEAMS][4];
 
 	private:
-	/* Description: Populates the neighbours table. Should be called once.
+	/* Description: Populates the neighbours table.
 	 * Args: None
 	 */
-	void compute_neighbours();
-	/* Description: Populates the archer attack table. Should be called once.
+	constexpr void compute_neighbours();
+	/* Description: Populates the archer attack table.
 	 * Args: None
 	 */
-	void compute_archer_attacks();
-	/* Description: Computes all k element subsets of an array of length n, for k = 1,...,4
-	 * 		and n = 1,...,4. Should be called once.
+	constexpr void compute_archer_attacks();
+	/* Description: Populates the zobrist keys from a fixed seed.
 	 * Args: None
 	 */
-	void compute_n_k_subsets();
+	constexpr void compute_zobrist();
 
 	public:
 
-	LookupTables();
+	constexpr LookupTables();
 };
 
 /*  |  A |  B |  C |  D |
@@ -101,67 +170,208 @@ class LookupTables {
  * -|----|----|----|----|
  */
 
-class Board {
+/*
+ * The board is packed so that the 4x4 board fits in a single 64 byte cache
+ * line. The type of the piece on a tile is not stored, it is recovered from the
+ * piece bitboards, and the hp of each tile is stored as a 4 bit nibble. The
+ * bitboards use the smallest integer type that has a bit for every tile.
+ */
+template <int W, int H>
+class BasicBoard {
 	public:
 
+	static constexpr int WIDTH = W;
+	static constexpr int HEIGHT = H;
+	static constexpr int SIZE = W * H;
+
+	typedef typename bitboard_types<SIZE>::type bitboard_t;
+	typedef typename bitboard_types<SIZE>::fast bitmap_t;
+
+	struct action {
+		uint_fast8_t pos; // location of action doer, SIZE for the skip action
+		bitboard_t trgts; // bitmap of the 1-4 targets, 0 for the skip action
+	};
+
+	// a swap or an action, which one is determined by the state of the board it is applied to
+	union MoveChoice {
+		struct {
+			uint_fast8_t first;
+			uint_fast8_t second;
+		} swap;
+		action act;
+	};
+
+	typedef MoveList<std::pair<uint_fast8_t, uint_fast8_t>, MAX_SWAPS(W, H)> SwapList;
+	typedef MoveList<action, MAX_ACTIONS(W, H)> ActionList;
+
+	// information needed to take back a move made with make_swap/make_action
+	struct undo {
+		MoveChoice move;
+		Turn_T state;
+		Team to_play;
+		Piece actor; // type of the piece that performed the action
+		Piece trgt_types[4]; // types of the targets from the lowest position up, needed to revive killed pieces
+		uint_fast8_t passes; // passes of the team that moved
+		uint_fast64_t zobrist;
+		int16_t score;
+		uint8_t status;
+	};
+
+	// packed game state returned by hash, a 128 bit integer when it fits
+	typedef std::conditional_t<HASH_BITS(SIZE) <= 128, uint_fast128_t,
+		std::array<uint64_t, (HASH_BITS(SIZE) + 63) / 64>> hash_t;
+
 	Turn_T state;
 	Team to_play;
 	// number of quarter turns
-	int_fast32_t turn_count;
+	int16_t turn_count;
 
 	private:
 
-	static LookupTables lookup;
-
-	uint_fast16_t pieces[NUM_TEAMS][NUM_PIECES];
+	static const LookupTables<W, H> lookup;
+	// number of 64 bit words holding the hp nibbles
+	static constexpr int HP_WORDS = (4 * SIZE + 63) / 64;
 
-	piece_stats info[BOARD_SIZE];
-
-	uint_fast16_t active[NUM_TEAMS];
-	uint_fast8_t passes[NUM_TEAMS];
+	uint8_t passes[NUM_TEAMS];
 
+	bitboard_t pieces[NUM_TEAMS][NUM_PIECES];
 	// stores a bitmap for each team representing where the pieces are
-	uint_fast16_t team_bitmaps[NUM_TEAMS];
+	bitboard_t team_bitmaps[NUM_TEAMS];
+	bitboard_t active[NUM_TEAMS];
 	// tracks pieces that don't have full hp and that are alive
-	uint_fast16_t damaged;
+	bitboard_t damaged;
+	// sum of tile_eval over the board, updated incrementally by every mutation
+	int16_t score;
+	// STATUS_* bits of the game over conditions that hold, updated wherever the active
+	// bitmaps, the kings or the passes change
+	uint8_t status;
+
+	// hp of each tile packed as 4 bit nibbles, tile i uses bits 4i to 4i+3 of the words
+	uint64_t hp[HP_WORDS];
+	// zobrist key of the position, updated incrementally by every mutation
+	uint64_t zobrist;
 
+	/* Description: returns the bitmap with only the bit of pos set.
+	 * Args: pos - the position of the bit.
+	 */
+	static constexpr bitmap_t bit(uint_fast8_t pos) { return (bitmap_t)1 << pos; }
 	/* Description: returns true if pos is within the board.
 	 * Args: pos - the position to check.
 	 */
-	bool inbound(uint_fast8_t pos);
+	bool inbound(uint_fast8_t pos) const;
+	/* Description: returns the hp of the tile at pos, 0 if the tile is empty.
+	 * Args: pos - the position to check.
+	 */
+	uint_fast8_t hp_at(uint_fast8_t pos) const;
+	/* Description: sets the hp of the tile at pos.
+	 * Args: pos - the position to update.
+	 * 	 hp - the new hp.
+	 */
+	void set_hp(uint_fast8_t pos, uint_fast8_t hp);
+	/* Description: returns the team of the piece at pos, the tile must not be empty.
+	 * Args: pos - the position to check.
+	 */
+	Team team_at(uint_fast8_t pos) const;
+	/* Description: returns the type of the piece at pos, EMPTY if the tile is empty.
+	 * Args: pos - the position to check.
+	 */
+	Piece piece_at(uint_fast8_t pos) const;
 	/* Description: populates the team_bitmaps bitmap according to the pieces array.
 	 * Args: None
 	 */
 	void compute_team_bitmaps();
-	/* Description: generates the valid swaps at pos and adds them to the swaps vector.
+	/* Description: recomputes the zobrist key from scratch.
+	 * Args: None
+	 */
+	void compute_key();
+	/* Description: returns the zobrist key of the piece at pos, 0 if the tile is empty.
+	 * Args: pos - the position of the piece.
+	 */
+	uint_fast64_t tile_key(uint_fast8_t pos) const;
+	/* Description: recomputes the STATUS_ISOLATED bit of team t.
+	 * Args: t - the team to update.
+	 */
+	void update_isolated(Team t);
+	/* Description: recomputes all the status bits from scratch.
+	 * Args: None
+	 */
+	void compute_status();
+	/* Description: returns the evaluation of the piece at pos in units of 1 / EVAL_SCALE,
+	 * 		positive for BLACK and negative for WHITE, 0 if the tile is empty.
+	 * Args: pos - the position of the piece.
+	 */
+	int_fast16_t tile_eval(uint_fast8_t pos) const;
+	/* Description: returns the sum of tile_eval over the positions in mask.
+	 * Args: mask - bitmap of the positions to evaluate.
+	 */
+	int_fast16_t tiles_eval(bitmap_t mask) const;
+	/* Description: returns the sum of the evaluation weights of the pieces in mask.
+	 * Args: mask - bitmap of the positions to sum over.
+	 */
+	int_fast16_t weights(bitmap_t mask) const;
+	/* Description: returns the change in the running evaluation caused by swapping the pieces
+	 * 		at pos1 and pos2, not counting the activity updates that follow a swap
+	 * 		between teams. Must be called before the swap.
+	 * Args: pos1 - position of first piece.
+	 * 	 pos2 - position of second piece.
+	 */
+	int_fast16_t swap_eval(uint_fast8_t pos1, uint_fast8_t pos2) const;
+	/* Description: recomputes the running evaluation from scratch.
+	 * Args: None
+	 */
+	void compute_eval();
+	/* Description: generates the valid swaps at pos, which holds a piece of team T, and adds
+	 * 		them to the swaps list.
 	 * Args: pos - the position to generate the swaps for.
-	 * 	 swaps - the vector to append the results to.
-	 * 	 seen - boolean array used to track duplicate swaps (i.e. [A1, A2] == [A2, A1])
-	 */
-	void generate_swaps_at(
-			uint_fast8_t pos,
-			std::vector<std::pair<uint_fast8_t, uint_fast8_t>> &swaps,
-			int seen[BOARD_SIZE][BOARD_SIZE]);
-	/* Description: generates the valid actions at pos and adds them to the actions vector.
+	 * 	 swaps - the list to append the results to.
+	 * 	 seen - bitmap of positions whose swaps were already generated, used to skip
+	 * 	 	duplicate swaps (i.e. [A1, A2] == [A2, A1])
+	 */
+	template <Team T>
+	void generate_swaps_at(uint_fast8_t pos, SwapList &swaps, bitmap_t seen);
+	/* Description: generates the valid actions at pos, which holds a piece of type P on team T,
+	 * 		and adds them to the actions list.
 	 * Args: pos - the position to generate the actions for.
-	 * 	 actions - the vector to append the results to.
+	 * 	 actions - the list to append the results to.
 	 */
-	void generate_actions_at(uint_fast8_t pos, std::vector<action> &actions);
+	template <Team T, Piece P>
+	void generate_actions_at(uint_fast8_t pos, ActionList &actions);
+	/* Description: apply_action for a board with team T to play.
+	 * Args: a - the action to be performed.
+	 */
+	template <Team T>
+	void apply_action_for(const action &a);
+	/* Description: make_action for a board with team T to play.
+	 * Args: a - the action to be performed.
+	 */
+	template <Team T>
+	undo make_action_for(const action &a);
 
 	public:
 
-	Board();
+	BasicBoard();
 	/* Description: Loads a game state from the given file. Return true if successful else false.
 	 * Args: f - the file to load the state from.
 	 */
 	bool load_file(std::string &f);
-	/* Description: Converts the current state of the board to a unsigned 128 bit integer.
+	/* Description: Converts the current state of the board to a unsigned 128 bit integer, or an
+	 * 		array of 64 bit words for boards that don't fit in 128 bits.
 	 */
-	uint_fast128_t hash();
+	hash_t hash();
 	/* Description: Loads the game state from the given unsinged 128 bit integer.
 	 * Args: state - the integer to load the game state from.
 	 */
-	bool load_hash(uint_fast128_t state);
+	bool load_hash(hash_t state);
+	/* Description: Returns the 64 bit zobrist key of the position. Covers the pieces, their hp, the
+	 * 		state, the team to play and the passes but not the turn count, so transpositions
+	 * 		reached at different turns share a key.
+	 */
+	uint_fast64_t key();
+	/* Description: Returns the material, activity and neighbour evaluation of the position in
+	 * 		units of 1 / EVAL_SCALE, positive values favour BLACK. Kept up to date by every
+	 * 		mutation so reading it is O(1), it does not account for the game being over.
+	 */
+	int_fast16_t eval() const;
 	/* Description: Returns the number of skips in a row Team t has used.
 	 * Args: t - the team to check.
 	 */
@@ -182,7 +392,7 @@ class Board {
 	 * Args: type - the type of the piece to place.
 	 * 	 colour - the team that the piece belongs to.
 	 * 	 hp - the amount of health points the piece will have.
-	 * 	 max_hp - the maximum hp of the piece.
+	 * 	 max_hp - the maximum hp of the piece, must match the type of the piece.
 	 * 	 pos - the position to place the piece.
 	 */
 	void place_piece(Piece type, Team colour, uint_fast8_t hp, uint_fast8_t max_hp, uint_fast8_t pos);
@@ -199,15 +409,79 @@ class Board {
 	/* Description: performs the action and updates the turn_count and state.
 	 * Args: a - the action to be performed.
 	 */
-	void apply_action(action &a);
+	void apply_action(const action &a);
+	/* Description: performs a swap like apply_swap and returns the record needed to unmake it.
+	 * Args: pos1 - position of first piece.
+	 * 	 pos2 - position of second piece.
+	 */
+	undo make_swap(uint_fast8_t pos1, uint_fast8_t pos2);
+	/* Description: performs an action like apply_action and returns the record needed to unmake it.
+	 * Args: a - the action to be performed.
+	 */
+	undo make_action(const action &a);
+	/* Description: performs the swap or action in m depending on the current state and returns
+	 * 		the record needed to unmake it.
+	 * Args: m - the move to be performed.
+	 */
+	undo make_move(const MoveChoice &m);
+	/* Description: make_move for a board in state S with team T to play, used by the search
+	 * 		which already knows both and so skips the dispatch.
+	 * Args: m - the move to be performed.
+	 */
+	template <Turn_T S, Team T>
+	undo make_move_for(const MoveChoice &m);
+	/* Description: takes back the move recorded in u, must be called in the reverse order the
+	 * 		moves were made.
+	 * Args: u - the record returned when the move was made.
+	 */
+	void unmake(const undo &u);
+	/* Description: unmake for a move made in state S by team T.
+	 * Args: u - the record returned when the move was made.
+	 */
+	template <Turn_T S, Team T>
+	void unmake_for(const undo &u);
 	/* Description: returns a vector of valid swaps for this board state. 
 	 * Args: None
 	 */
 	std::vector<std::pair<uint_fast8_t, uint_fast8_t>> generate_swaps();
+	/* Description: fills swaps with the valid swaps for this board state, in the same order as
+	 * 		generate_swaps() and without allocating.
+	 * Args: swaps - the list to fill, any previous contents are cleared.
+	 */
+	void generate_swaps(SwapList &swaps);
+	/* Description: generate_swaps for a board with team T to play.
+	 * Args: swaps - the list to fill, any previous contents are cleared.
+	 */
+	template <Team T>
+	void generate_swaps_for(SwapList &swaps);
 	/* Description: returns a vector of valid actions for this board state.
 	 * Args: None
 	 */
 	std::vector<action> generate_actions();
+	/* Description: fills actions with the valid actions for this board state, in the same order as
+	 * 		generate_actions() and without allocating.
+	 * Args: actions - the list to fill, any previous contents are cleared.
+	 */
+	void generate_actions(ActionList &actions);
+	/* Description: generate_actions for a board with team T to play.
+	 * Args: actions - the list to fill, any previous contents are cleared.
+	 */
+	template <Team T>
+	void generate_actions_for(ActionList &actions);
+	/* Description: returns true if the action kills at least one enemy piece, the action must
+	 * 		be valid for this board state.
+	 * Args: a - the action to check.
+	 */
+	bool kills(const action &a) const;
+	/* Description: returns true if the action heals a friendly piece that one more hit would
+	 * 		kill, the action must be valid for this board state.
+	 * Args: a - the action to check.
+	 */
+	bool saves(const action &a) const;
+	/* Description: returns the piece information of the tile at pos.
+	 * Args: pos - the position of the tile.
+	 */
+	piece_stats tile(uint_fast8_t pos) const;
 	/* Description: returns a vector of piece information for each tile.
 	 * Args: None
 	 */
@@ -234,12 +508,19 @@ class Board {
 	 * Args: None
 	 */
 	std::pair<Team, Win_Condition> winner();
-
-	friend std::ostream &operator<<(std::ostream &os, const Board &b);
 };
 
+// the standard 4x4 board and its moves
+typedef BasicBoard<BOARD_WIDTH, BOARD_HEIGHT> Board;
+typedef Board::action action;
+typedef Board::MoveChoice MoveChoice;
+typedef Board::SwapList SwapList;
+typedef Board::ActionList ActionList;
+typedef Board::undo undo;
+
 // ostream overloads
-std::ostream &operator<<(std::ostream &os, const Board &b);
+template <int W, int H>
+std::ostream &operator<<(std::ostream &os, const BasicBoard<W, H> &b);
 
 std::ostream &operator<<(std::ostream &os, const Team &t);
 
@@ -248,3 +529,8 @@ std::ostream &operator<<(std::ostream &os, const Piece &p);
 std::ostream &operator<<(std::ostream &os, const Turn_T &t);
 
 std::ostream &operator<<(std::ostream &os, const Win_Condition &w);
+
+/* Description: returns the maximum hp of a piece of type p, 0 for EMPTY.
+ * Args: p - the type of piece.
+ */
+int piece_max_hp(Piece p);
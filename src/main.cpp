@@ -11,6 +11,9 @@
 #define FF_SUCCESS_STRING(msg) "\033[32;1m" << msg << "\033[0m"
 #define FF_ACTIVE_STRING(msg) "\033[33m" << msg << "\033[0m"
 #define FF_INACTIVE_STRING(msg) "\033[34m" << msg << "\033[0m"
+// caps the nodes searched while waiting for a human, the search tree stays in memory until
+// the human moves
+#define PONDER_NODE_LIMIT 2000000
 
 const std::string index2rank_file[] = {
 	"A1", "B1", "C1", "D1",
@@ -29,14 +32,8 @@ struct Config {
 	std::string filename;
 	int hint_depth;
 	int search_depth;
-};
-
-union MoveChoice {
-	struct {
-		uint_fast8_t first;
-		uint_fast8_t second;
-	} swap;
-	action act;
+	int threads;
+	int move_time; // milliseconds the computer may think per move, 0 for no limit
 };
 
 
@@ -47,8 +44,9 @@ int setup_menu(Config &config)
 
 	std::cout << "<< " FF_ACTIVE_STRING("Setup Screen") << " >>\n";
 	std::cout << "Enter the game configuration as follows:\n" 
-		<< "\t player1\t\tplayer2\t\t\thint depth\tsearch depth\n"
-		<< "\t(human or computer)\t(human or computer)\t[0-9]\t\t[0-9]" << std::endl;
+		<< "\t player1\t\tplayer2\t\t\thint depth\tsearch depth\tthreads (optional)\tmove time ms (optional)\n"
+		<< "\t(human or computer)\t(human or computer)\t[0-9]\t\t[0-9]\t\t[1-64]\t\t\t[0-600000]\n"
+		<< "\tA search depth of 0 searches until the move time is up." << std::endl;
 	std:: cout << ">>> ";
 	std::cout.flush();
 
@@ -79,6 +77,24 @@ int setup_menu(Config &config)
 	}
 	copy.search_depth = std::stoi(cmd);
 
+	if (ss >> cmd) {
+		copy.threads = std::stoi(cmd);
+		if (copy.threads < 1 || copy.threads > 64) {
+			return 1;
+		}
+	}
+
+	if (ss >> cmd) {
+		copy.move_time = std::stoi(cmd);
+		if (copy.move_time < 0 || copy.move_time > 600000) {
+			return 1;
+		}
+	}
+	// without a depth the search needs a time limit to stop
+	if (copy.search_depth <= 0 && copy.move_time == 0) {
+		return 1;
+	}
+
 	config = copy;
 	std::cout << "Writing new configuration..." << std::endl;
 	return 0;
@@ -209,9 +225,12 @@ std::string pretty_print_action(action &action)
 		out = " (SKIP)";
 	} else {
 		out = " (" + index2rank_file[action.pos] + ", [";
-		for (int i = 0; i < action.num_trgts; ++i) {
-			out += index2rank_file[action.trgts[i]];
-			if (i != action.num_trgts - 1) {
+		for (int pos = 0; pos < BOARD_SIZE; ++pos) {
+			if (!(action.trgts >> pos & 1)) {
+				continue;
+			}
+			out += index2rank_file[pos];
+			if (action.trgts >> (pos + 1)) {
 				out += ", ";
 			}
 		}
@@ -220,11 +239,12 @@ std::string pretty_print_action(action &action)
 	return out;
 }
 
-void display_moves(Board &b, int depth)
+void display_moves(Board &b, int depth, SearchSession &session, const SearchOptions &options)
 {
 	int index = -1;
 	if (depth) {
-		index = suggest_move(b, depth);
+		// the computer's search of this position continues from the hint's search
+		index = session.suggest_move(b, depth, options);
 	}
 
 	if (b.state == SWAP) {
@@ -267,20 +287,9 @@ bool is_swap_valid(std::vector<uint_fast8_t> swap, std::vector<std::pair<uint_fa
 }
 
 bool is_action_valid(action a, std::vector<action> valid_actions) {
-	// order action trgts from least to greatest
-	std::sort(a.trgts, a.trgts + a.num_trgts);
 	for (auto &va : valid_actions) {
-		bool differ = false;
-		if (va.pos == a.pos && va.num_trgts == a.num_trgts) {
-			for (int i = 0; i < va.num_trgts; ++i) {
-				if (va.trgts[i] != a.trgts[i]) {
-					differ = true;
-					break;
-				}	
-			}
-			if (!differ) {
-				return true;
-			}
+		if (va.pos == a.pos && va.trgts == a.trgts) {
+			return true;
 		}
 	}
 	return false;
@@ -319,10 +328,14 @@ int human_get_input(Board &b, MoveChoice &choice)
 		} 
 
 		choice.act.pos = locations[0];
-		choice.act.num_trgts = locations.size() - 1;
+		choice.act.trgts = 0;
 
 		for (int i = 1; i < locations.size(); ++i) {
-			choice.act.trgts[i - 1] = locations[i];
+			if (locations[i] >= BOARD_SIZE || (choice.act.trgts >> locations[i] & 1)) {
+				std::cout << FF_ERROR_STRING("Invalid action provided, try again...\n") << std::endl;
+				return 1;
+			}
+			choice.act.trgts |= 1 << locations[i];
 		}
 		
 		if (!is_action_valid(choice.act, b.generate_actions())) {
@@ -341,6 +354,17 @@ void play(Board &b, Config &config)
 	}
 	
 	std::pair<Team, Win_Condition> winner_info{NONE, NO_WINNER};
+	SearchOptions options;
+	options.threads = config.threads;
+	// only the computer's moves are timed, the hints search to their depth
+	SearchOptions move_options{options};
+	move_options.time_limit = std::chrono::milliseconds{config.move_time};
+	// the human's position is a ply above the computer's, search one ply deeper
+	SearchOptions ponder_options{options};
+	ponder_options.node_limit = PONDER_NODE_LIMIT;
+	const int ponder_depth = config.search_depth > 0 ? config.search_depth + 1 : 0;
+	// keeps the search tree of the hints, the computer and pondering between turns
+	SearchSession session;
 	
 	while (1) {
 		Team turn = b.to_play;
@@ -350,18 +374,33 @@ void play(Board &b, Config &config)
 			<< "\n" << std::endl;
 
 		pretty_print_board(b);
-		display_moves(b, config.hint_depth);
+		display_moves(b, config.hint_depth, session, options);
 
 		MoveChoice choice;
 
 		if (config.players[turn] == HUMAN) {
-			if (human_get_input(b, choice)) {
+			// search the position while the human thinks, the computer's search reuses the
+			// tree and table entries whichever move the human plays
+			const bool ponder = config.players[1 - turn] == COMPUTER;
+			if (ponder) {
+				start_pondering(b, ponder_depth, ponder_options, &session);
+			}
+			const int bad_input = human_get_input(b, choice);
+			if (ponder) {
+				stop_pondering();
+			}
+			if (bad_input) {
 				continue;
 			}
 		} else {
 			// computer move
 			std::cout << "Move: ";
-			const int move_index = suggest_move(b, config.search_depth);
+			SearchResult result;
+			const int move_index = session.suggest_move(b, config.search_depth, move_options, &result);
+#ifdef FF_SEARCH_STATS
+			// on stderr so the statistics can be collected apart from the game
+			std::cerr << to_json(result) << std::endl;
+#endif
 			if (b.state == SWAP) {
 				auto swaps = b.generate_swaps();
 				choice.swap.first = swaps[move_index].first; 
@@ -375,6 +414,7 @@ void play(Board &b, Config &config)
 			std::cout << "\n" << std::endl;
 		}
 
+		session.advance(choice);
 		if (b.state == SWAP) {
 			b.apply_swap(choice.swap.first, choice.swap.second);
 		} else {
@@ -395,7 +435,7 @@ void play(Board &b, Config &config)
 int main(int argc, char *argv[])
 {
 	Board b;
-	Config config{{HUMAN, COMPUTER}, "config/positions/default1.txt", 0, 6};
+	Config config{{HUMAN, COMPUTER}, "config/positions/default1.txt", 0, 6, 1, 0};
 
 	while (1) {
 		if (main_menu(config)) {
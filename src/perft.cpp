@@ -0,0 +1,67 @@
+#include "perft.h"
+
+
+template <int W, int H>
+uint64_t perft(BasicBoard<W, H> &b, int depth)
+{
+	if (depth <= 0 || b.gameover()) {
+		return 1;
+	}
+
+	uint64_t nodes = 0;
+
+	if (b.state == SWAP) {
+		typename BasicBoard<W, H>::SwapList swaps;
+		b.generate_swaps(swaps);
+		for (auto &swap : swaps) {
+			BasicBoard<W, H> child{b};
+			child.apply_swap(swap.first, swap.second);
+			nodes += perft(child, depth - 1);
+		}
+	} else {
+		typename BasicBoard<W, H>::ActionList actions;
+		b.generate_actions(actions);
+		for (auto &act : actions) {
+			BasicBoard<W, H> child{b};
+			child.apply_action(act);
+			nodes += perft(child, depth - 1);
+		}
+	}
+
+	return nodes;
+}
+
+template <int W, int H>
+std::vector<uint64_t> perft_divide(BasicBoard<W, H> &b, int depth)
+{
+	assert(depth >= 1);
+	std::vector<uint64_t> out;
+
+	if (b.state == SWAP) {
+		typename BasicBoard<W, H>::SwapList swaps;
+		b.generate_swaps(swaps);
+		for (auto &swap : swaps) {
+			BasicBoard<W, H> child{b};
+			child.apply_swap(swap.first, swap.second);
+			out.push_back(perft(child, depth - 1));
+		}
+	} else {
+		typename BasicBoard<W, H>::ActionList actions;
+		b.generate_actions(actions);
+		for (auto &act : actions) {
+			BasicBoard<W, H> child{b};
+			child.apply_action(act);
+			out.push_back(perft(child, depth - 1));
+		}
+	}
+
+	return out;
+}
+
+#define INSTANTIATE_PERFT(w, h) \
+	template uint64_t perft(BasicBoard<w, h> &b, int depth); \
+	template std::vector<uint64_t> perft_divide(BasicBoard<w, h> &b, int depth);
+
+INSTANTIATE_PERFT(4, 4)
+INSTANTIATE_PERFT(5, 5)
+INSTANTIATE_PERFT(6, 6)
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "board.h"
+
+
+/* Description: returns the number of leaf nodes of the game tree depth quarter turns
+ * 		below b. Positions where the game is over are leaves and count once.
+ * Args: b - the board state to count from.
+ * 	 depth - the number of quarter turns to search.
+ */
+template <int W, int H>
+uint64_t perft(BasicBoard<W, H> &b, int depth);
+/* Description: returns the perft count below each root move, in the order the moves are
+ * 		generated. The sum of the counts is perft(b, depth).
+ * Args: b - the board state to count from.
+ * 	 depth - the number of quarter turns to search, must be at least 1.
+ */
+template <int W, int H>
+std::vector<uint64_t> perft_divide(BasicBoard<W, H> &b, int depth);
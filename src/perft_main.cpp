@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstring>
+#include <string>
+#include "board.h"
+#include "perft.h"
+
+
+/* Description: returns the rank and file name of pos (e.g. A1).
+ * Args: pos - the position to name.
+ */
+std::string pos2str(uint_fast8_t pos)
+{
+	return std::string{(char)('A' + pos % BOARD_WIDTH), (char)('1' + pos / BOARD_WIDTH)};
+}
+
+/* Description: prints the perft count below each root move.
+ * Args: b - the board state to count from.
+ * 	 depth - the number of quarter turns to search.
+ */
+void print_divide(Board &b, int depth)
+{
+	auto counts = perft_divide(b, depth);
+
+	if (b.state == SWAP) {
+		auto swaps = b.generate_swaps();
+		for (size_t i = 0; i < swaps.size(); ++i) {
+			std::cout << pos2str(swaps[i].first) << " " << pos2str(swaps[i].second)
+				<< ": " << counts[i] << "\n";
+		}
+	} else {
+		auto actions = b.generate_actions();
+		for (size_t i = 0; i < actions.size(); ++i) {
+			auto &act = actions[i];
+			if (act.pos == BOARD_SIZE) {
+				std::cout << "SKIP";
+			} else {
+				std::cout << pos2str(act.pos);
+				for (int pos = 0; pos < BOARD_SIZE; ++pos) {
+					if (act.trgts >> pos & 1) {
+						std::cout << " " << pos2str(pos);
+					}
+				}
+			}
+			std::cout << ": " << counts[i] << "\n";
+		}
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " <position file> <depth> [--divide]" << std::endl;
+		return 1;
+	}
+
+	std::string filename{argv[1]};
+	const int depth = std::stoi(argv[2]);
+	const bool divide = argc > 3 && std::strcmp(argv[3], "--divide") == 0;
+	Board b;
+
+	if (!b.load_file(filename)) {
+		std::cerr << "Couldn't load the position " << filename << std::endl;
+		return 1;
+	}
+
+	if (divide && depth > 0) {
+		print_divide(b, depth);
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const uint64_t nodes = perft(b, depth);
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << "Nodes: " << nodes << "\n"
+		<< "Time: " << elapsed.count() << "s\n"
+		<< "Nodes/sec: " << (uint64_t)(nodes / std::max(elapsed.count(), 1e-9)) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include <iterator>
+#include "thread_pool.h"
+
+
+// worker 0 is the thread using the pool from outside
+static thread_local int current_worker = 0;
+
+
+ThreadPool::ThreadPool(): pending{0}, quit{false}
+{
+	resize(1);
+}
+
+ThreadPool::~ThreadPool()
+{
+	stop();
+}
+
+void ThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard{this->sleep_lock};
+		this->quit = true;
+	}
+	this->wake.notify_all();
+	for (auto &t : this->threads) {
+		t.join();
+	}
+	this->threads.clear();
+	this->quit = false;
+}
+
+void ThreadPool::resize(int num_workers)
+{
+	if (num_workers < 1) {
+		num_workers = 1;
+	}
+	if (num_workers == size()) {
+		return;
+	}
+	stop();
+
+	this->queues.clear();
+	for (int i = 0; i < num_workers; ++i) {
+		this->queues.emplace_back(new Queue);
+	}
+	for (int i = 1; i < num_workers; ++i) {
+		this->threads.emplace_back(&ThreadPool::worker_loop, this, i);
+	}
+}
+
+int ThreadPool::worker_id()
+{
+	return current_worker;
+}
+
+void ThreadPool::worker_loop(int id)
+{
+	current_worker = id;
+
+	while (1) {
+		if (run_one()) {
+			continue;
+		}
+		std::unique_lock<std::mutex> guard{this->sleep_lock};
+		this->wake.wait(guard, [this] { return this->quit || this->pending.load() > 0; });
+		if (this->quit) {
+			return;
+		}
+	}
+}
+
+void ThreadPool::push(Task *t)
+{
+	Queue &q = *this->queues[current_worker];
+	{
+		std::lock_guard<std::mutex> guard{q.lock};
+		q.tasks.push_back(t);
+	}
+	this->pending.fetch_add(1);
+
+	// taking the lock orders the increment with a worker checking pending before sleeping
+	{
+		std::lock_guard<std::mutex> guard{this->sleep_lock};
+	}
+	this->wake.notify_one();
+}
+
+Task *ThreadPool::take(int id)
+{
+	const int n = size();
+
+	for (int i = 0; i < n; ++i) {
+		Queue &q = *this->queues[(id + i) % n];
+		std::lock_guard<std::mutex> guard{q.lock};
+		if (q.tasks.empty()) {
+			continue;
+		}
+		Task *t;
+		// take from the back of our own deque and steal from the front of the others
+		if (i == 0) {
+			t = q.tasks.back();
+			q.tasks.pop_back();
+		} else {
+			t = q.tasks.front();
+			q.tasks.pop_front();
+		}
+		this->pending.fetch_sub(1);
+		t->state.store(TASK_RUNNING, std::memory_order_relaxed);
+		return t;
+	}
+
+	return nullptr;
+}
+
+bool ThreadPool::reclaim(Task *t)
+{
+	Queue &q = *this->queues[current_worker];
+	std::lock_guard<std::mutex> guard{q.lock};
+
+	// the task the owner needs next is usually at the back
+	for (auto it = q.tasks.rbegin(); it != q.tasks.rend(); ++it) {
+		if (*it == t) {
+			q.tasks.erase(std::next(it).base());
+			this->pending.fetch_sub(1);
+			t->state.store(TASK_RUNNING, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ThreadPool::run_one()
+{
+	Task *t = take(current_worker);
+	if (!t) {
+		return false;
+	}
+	t->run();
+	t->finish();
+	return true;
+}
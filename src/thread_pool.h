@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+enum Task_State : uint8_t {
+	TASK_PENDING = 0,
+	TASK_RUNNING,
+	TASK_DONE
+};
+
+/*
+ * Unit of work run by a ThreadPool. A task leaves the queue it was pushed on
+ * exactly once, either taken by a worker that runs it or reclaimed by the
+ * thread that pushed it, so the pusher may free it once it is reclaimed or done.
+ */
+struct Task {
+	std::atomic<uint8_t> state{TASK_PENDING};
+
+	virtual void run() = 0;
+
+	/* Description: marks a taken task as finished, its results are visible to the
+	 * 		threads that see it done.
+	 * Args: None
+	 */
+	void finish() { this->state.store(TASK_DONE, std::memory_order_release); }
+	bool done() const { return this->state.load(std::memory_order_acquire) == TASK_DONE; }
+};
+
+/*
+ * Work stealing pool. Every worker has a deque of tasks, tasks pushed by a worker
+ * go on the back of its own deque, it takes work from the back of its deque and
+ * steals from the front of the other deques when its own is empty. The thread
+ * using the pool from outside counts as worker 0, only one such thread may use
+ * the pool at a time.
+ */
+class ThreadPool {
+	struct Queue {
+		std::mutex lock;
+		std::deque<Task *> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+	std::mutex sleep_lock;
+	std::condition_variable wake;
+	std::atomic<int> pending; // tasks sitting in the queues
+	bool quit;
+
+	/* Description: runs tasks until the pool is stopped, sleeping while there is no work.
+	 * Args: id - the index of the worker.
+	 */
+	void worker_loop(int id);
+	/* Description: removes and returns a task for worker id, nullptr if every queue is empty.
+	 * Args: id - the index of the worker.
+	 */
+	Task *take(int id);
+	/* Description: joins all the worker threads.
+	 * Args: None
+	 */
+	void stop();
+
+	public:
+
+	ThreadPool();
+	~ThreadPool();
+	/* Description: sets the number of workers including the calling thread, must
+	 * 		not be called while tasks are queued or running.
+	 * Args: num_workers - the number of workers, at least 1.
+	 */
+	void resize(int num_workers);
+	/* Description: returns the number of workers including the calling thread.
+	 * Args: None
+	 */
+	int size() const { return this->queues.size(); }
+	/* Description: returns the index of the worker running the calling thread.
+	 * Args: None
+	 */
+	static int worker_id();
+	/* Description: queues t on the calling worker's deque.
+	 * Args: t - the task to queue, must outlive its execution.
+	 */
+	void push(Task *t);
+	/* Description: removes t from the calling worker's deque, returns false if another
+	 * 		worker already took it.
+	 * Args: t - a task pushed by the calling worker.
+	 */
+	bool reclaim(Task *t);
+	/* Description: takes a queued task and runs it, returns false if there was no
+	 * 		task to take.
+	 * Args: None
+	 */
+	bool run_one();
+};
@@ -0,0 +1,107 @@
+#include <cstring>
+#include "transposition.h"
+
+
+TranspositionTable::TranspositionTable(size_t mb): size{0}, mask{0}, generation{1}
+{
+	resize(mb);
+}
+
+void TranspositionTable::resize(size_t mb)
+{
+	// round the number of buckets down to a power of two so that the key can be masked
+	size_t n = 1;
+	while (2 * n * sizeof(bucket) <= mb * 1024 * 1024) {
+		n *= 2;
+	}
+
+	this->table.reset(new bucket[n]);
+	this->size = n;
+	this->mask = n - 1;
+	clear();
+}
+
+void TranspositionTable::clear()
+{
+	for (size_t i = 0; i < this->size; ++i) {
+		for (int j = 0; j < TT_BUCKET_SIZE; ++j) {
+			this->table[i].slots[j].key.store(0, std::memory_order_relaxed);
+			this->table[i].slots[j].data.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+void TranspositionTable::new_search()
+{
+	// generation 0 is reserved for empty slots
+	this->generation = this->generation == 0xff ? 1 : this->generation + 1;
+}
+
+uint64_t TranspositionTable::pack(const tt_entry &e)
+{
+	uint32_t score;
+	std::memcpy(&score, &e.score, sizeof(score));
+
+	return (uint64_t)score
+		| ((uint64_t)(uint8_t)e.depth << 32)
+		| ((uint64_t)(e.bound & 0x3) << 40)
+		| ((uint64_t)(e.move & 0xff) << 42)
+		| ((uint64_t)this->generation << 56);
+}
+
+uint_fast8_t TranspositionTable::unpack(uint64_t data, tt_entry &e)
+{
+	const uint32_t score = data & 0xffffffff;
+	std::memcpy(&e.score, &score, sizeof(score));
+
+	e.depth = (int8_t)((data >> 32) & 0xff);
+	e.bound = (Bound_T)((data >> 40) & 0x3);
+	e.move = (data >> 42) & 0xff;
+
+	return data >> 56;
+}
+
+bool TranspositionTable::probe(uint64_t key, tt_entry &e)
+{
+	bucket &b = this->table[key & this->mask];
+
+	for (int i = 0; i < TT_BUCKET_SIZE; ++i) {
+		slot &s = b.slots[i];
+		const uint64_t data = s.data.load(std::memory_order_relaxed);
+		// generation 0 marks an empty slot
+		if ((s.key.load(std::memory_order_relaxed) ^ data) == key && unpack(data, e) != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TranspositionTable::store(uint64_t key, const tt_entry &e)
+{
+	bucket &b = this->table[key & this->mask];
+	slot *replace = &b.slots[0];
+	int worst = INT32_MAX;
+	tt_entry old;
+
+	for (int i = 0; i < TT_BUCKET_SIZE; ++i) {
+		slot &s = b.slots[i];
+		const uint64_t data = s.data.load(std::memory_order_relaxed);
+		const uint_fast8_t gen = unpack(data, old);
+
+		if ((s.key.load(std::memory_order_relaxed) ^ data) == key) {
+			replace = &s;
+			break;
+		}
+		// prefer replacing entries from old searches, then the shallowest entry
+		const int value = gen == this->generation ? old.depth : INT8_MIN - 1;
+		if (value < worst) {
+			worst = value;
+			replace = &s;
+		}
+	}
+
+	const uint64_t data = pack(e);
+	replace->key.store(key ^ data, std::memory_order_relaxed);
+	replace->data.store(data, std::memory_order_relaxed);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+// number of entries sharing one bucket, a bucket fills a 64 byte cache line
+#define TT_BUCKET_SIZE 4
+#define TT_NO_MOVE 0xff
+
+enum Bound_T {
+	EXACT = 0,
+	LOWER_BOUND,
+	UPPER_BOUND
+};
+
+struct tt_entry {
+	float score;
+	int_fast8_t depth;
+	Bound_T bound;
+	uint_fast8_t move; // index of the best move found, TT_NO_MOVE if unknown
+};
+
+/*
+ * Fixed size, bucketed hash table storing search results keyed on a 64 bit
+ * position key. Each slot stores a packed data word (score, depth, bound, best
+ * move, generation), the generation is used to replace entries from previous
+ * searches first. The table is shared between search threads without locks, each
+ * slot stores the key xored with the data so a torn read of a slot that is
+ * being written by another thread fails to match the key.
+ */
+class TranspositionTable {
+	struct slot {
+		std::atomic<uint64_t> key; // key ^ data
+		std::atomic<uint64_t> data;
+	};
+
+	struct alignas(64) bucket {
+		slot slots[TT_BUCKET_SIZE];
+	};
+
+	std::unique_ptr<bucket[]> table;
+	size_t size; // number of buckets
+	uint64_t mask;
+	uint_fast8_t generation;
+
+	/* Description: packs an entry and the current generation into a data word.
+	 * Args: e - the entry to pack.
+	 */
+	uint64_t pack(const tt_entry &e);
+	/* Description: unpacks the data word into e, returns the generation it was stored in.
+	 * Args: data - the data word to unpack.
+	 * 	 e - the entry to populate.
+	 */
+	uint_fast8_t unpack(uint64_t data, tt_entry &e);
+
+	public:
+
+	/* Description: creates a table using at most mb megabytes.
+	 * Args: mb - the size of the table in megabytes.
+	 */
+	TranspositionTable(size_t mb = 16);
+	/* Description: resizes the table to use at most mb megabytes, all entries are dropped.
+	 * Args: mb - the size of the table in megabytes.
+	 */
+	void resize(size_t mb);
+	/* Description: removes all entries from the table.
+	 * Args: None
+	 */
+	void clear();
+	/* Description: starts a new search, entries from previous searches are still returned by
+	 * 		probe but are replaced first. Must not be called while other threads use
+	 * 		the table.
+	 * Args: None
+	 */
+	void new_search();
+	/* Description: looks up key, returns true and populates e if an entry was found.
+	 * Args: key - the position key to look up.
+	 * 	 e - the entry to populate.
+	 */
+	bool probe(uint64_t key, tt_entry &e);
+	/* Description: stores a search result for key, replacing the shallowest or oldest
+	 * 		entry in the bucket if key is not already present.
+	 * Args: key - the position key to store.
+	 * 	 e - the search result.
+	 */
+	void store(uint64_t key, const tt_entry &e);
+};
@@ -13,6 +13,12 @@ TEST(BoardBasicTests, Setup)
 	EXPECT_EQ(b.get_passes(t), 0) << "Skips for " << t << " is initialized to " << (int)b.get_passes(t);
 }
 
+TEST(BoardBasicTests, Layout)
+{
+	// the whole position should fit in a single cache line
+	EXPECT_LE(sizeof(Board), 64);
+}
+
 TEST(BoardLoadingTests, DNE)
 {
 	Board b;
@@ -92,8 +98,7 @@ TEST(BoardBug, MedicOverheal)
 
 	action a;
 	a.pos = 1;
-	a.num_trgts = 1;
-	a.trgts[0] = 13;
+	a.trgts = 1 << 13;
 	
 	b.apply_action(a);
 
@@ -111,6 +116,22 @@ TEST(BoardBug, MedicOverheal)
 	ASSERT_EQ(actions.size(), 1);
 }
 
+TEST(BoardBug, ActionListOverflow)
+{
+	// thirteen medics surrounded by damaged friends have more actions than the standard army
+	// can, the fixed capacity action list used to overflow on this position
+	Board b, loaded;
+
+	std::string file_name = "test_positions/medic_army.txt";
+	ASSERT_EQ(b.load_file(file_name), true);
+	ASSERT_EQ(loaded.load_hash(b.hash()), true);
+
+	ActionList actions;
+	loaded.generate_actions(actions);
+	EXPECT_EQ(actions.size(), 70);
+	EXPECT_EQ(b.generate_actions().size(), 70);
+}
+
 TEST(BoardHashingTests, Simple)
 {
 	Board b1, b2;
@@ -137,3 +158,242 @@ TEST(BoardHashingTests, Simple)
 		EXPECT_EQ(t1.max_hp, t2.max_hp);
 	}
 }
+
+TEST(BoardHashingTests, ZobristIncremental)
+{
+	// the incrementally updated key must match a key computed from scratch
+	Board b1, b2;
+
+	std::string file_name = "../config/positions/default1.txt";
+	ASSERT_EQ(b1.load_file(file_name), true);
+
+	for (int i = 0; i < 40 && !b1.gameover(); ++i) {
+		if (b1.state == SWAP) {
+			auto swaps = b1.generate_swaps();
+			auto &s = swaps[i % swaps.size()];
+			b1.apply_swap(s.first, s.second);
+		} else {
+			auto actions = b1.generate_actions();
+			b1.apply_action(actions[i % actions.size()]);
+		}
+		ASSERT_EQ(b2.load_hash(b1.hash()), true);
+		EXPECT_EQ(b1.key(), b2.key()) << "Key mismatch after " << i + 1 << " quarter turns";
+	}
+}
+
+TEST(BoardHashingTests, ZobristIgnoresTurnCount)
+{
+	Board b1, b2;
+
+	std::string file_name = "test_positions/medic_bug.txt";
+	ASSERT_EQ(b1.load_file(file_name), true);
+
+	auto state = b1.hash();
+	// bump the quarter turn count stored in the top bits of the packed state
+	state += ((uint_fast128_t)4) << (7 * BOARD_SIZE + 6);
+	ASSERT_EQ(b2.load_hash(state), true);
+
+	EXPECT_NE(b1.turn_count, b2.turn_count);
+	EXPECT_NE(b1.hash(), b2.hash());
+	EXPECT_EQ(b1.key(), b2.key());
+
+	// skipping changes the passes and so must change the key
+	action skip{BOARD_SIZE, 0};
+	b2.apply_action(skip);
+	EXPECT_NE(b1.key(), b2.key());
+}
+
+TEST(BoardEvalTests, Incremental)
+{
+	// the running evaluation must match the evaluation of each tile
+	static const float multipliers[NUM_PIECES] = {1.0, 0.9, 0.6, 0.7, 0.7, 0.65};
+	Board b;
+
+	std::string file_name = "../config/positions/default1.txt";
+	ASSERT_EQ(b.load_file(file_name), true);
+
+	for (int i = 0; i < 40 && !b.gameover(); ++i) {
+		if (b.state == SWAP) {
+			auto swaps = b.generate_swaps();
+			auto &s = swaps[(3 * i) % swaps.size()];
+			b.apply_swap(s.first, s.second);
+		} else {
+			auto actions = b.generate_actions();
+			b.apply_action(actions[(3 * i) % actions.size()]);
+		}
+
+		float expected = 0;
+		auto tiles = b.tile_info();
+		for (int pos = 0; pos < BOARD_SIZE; ++pos) {
+			if (tiles[pos].hp <= 0) {
+				continue;
+			}
+			float points = (tiles[pos].active ? 1.5 * tiles[pos].hp : tiles[pos].hp) + b.num_friendly_neighbours(pos) * 0.5;
+			expected += multipliers[tiles[pos].type] * points * (tiles[pos].team == BLACK ? 1 : -1);
+		}
+		EXPECT_NEAR((float)b.eval() / EVAL_SCALE, expected, 1e-3) << "Evaluation mismatch after " << i + 1 << " quarter turns";
+	}
+}
+
+TEST(BoardStatusTests, Surrender)
+{
+	Board b;
+
+	std::string file_name = "../config/positions/default1.txt";
+	ASSERT_EQ(b.load_file(file_name), true);
+
+	// skip three times in a row with BLACK, WHITE swaps back and forth
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_EQ(b.gameover(), false);
+		auto swaps = b.generate_swaps();
+		b.apply_swap(swaps[0].first, swaps[0].second);
+		b.apply_action(action{BOARD_SIZE, 0});
+		if (i == 2) {
+			break;
+		}
+		swaps = b.generate_swaps();
+		b.apply_swap(swaps[0].first, swaps[0].second);
+		b.apply_action(action{BOARD_SIZE, 0});
+	}
+
+	EXPECT_EQ(b.surrendered(BLACK), true);
+	EXPECT_EQ(b.surrendered(WHITE), false);
+	EXPECT_EQ(b.gameover(), true);
+	EXPECT_EQ(b.winner(), std::make_pair(WHITE, SURRENDERED));
+}
+
+TEST(BoardActionTests, KillsAndSaves)
+{
+	const std::string files[] = {
+		"../config/positions/default1.txt",
+		"../config/positions/analysis1.txt",
+		"../config/positions/endgame1.txt"
+	};
+
+	for (auto file_name : files) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+
+		for (int i = 0; i < 40 && !b.gameover(); ++i) {
+			if (b.state == SWAP) {
+				auto swaps = b.generate_swaps();
+				auto &s = swaps[(5 * i) % swaps.size()];
+				b.apply_swap(s.first, s.second);
+				continue;
+			}
+
+			// compare against the tiles before and after applying each action
+			auto actions = b.generate_actions();
+			auto before = b.tile_info();
+			for (auto &a : actions) {
+				Board child{b};
+				child.apply_action(a);
+				auto after = child.tile_info();
+				bool killed = false;
+				bool saved = false;
+				for (int pos = 0; pos < BOARD_SIZE; ++pos) {
+					killed |= before[pos].hp > 0 && before[pos].team != b.to_play && after[pos].hp <= 0;
+					saved |= before[pos].hp == 1 && before[pos].team == b.to_play && after[pos].type == before[pos].type
+						&& after[pos].hp == 2;
+				}
+				EXPECT_EQ(b.kills(a), killed) << file_name << " action at " << (int)a.pos;
+				EXPECT_EQ(b.saves(a), saved) << file_name << " action at " << (int)a.pos;
+			}
+			b.apply_action(actions[(5 * i) % actions.size()]);
+		}
+	}
+}
+
+/* Description: makes and unmakes every move from b down to depth, checking that each
+ * 		unmake restores the packed state, key, evaluation, status and activity of the board
+ * 		and that each make leaves the same evaluation and status as computing them from
+ * 		scratch.
+ */
+template <int W, int H>
+static void check_make_unmake(BasicBoard<W, H> &b, int depth)
+{
+	typedef typename BasicBoard<W, H>::MoveChoice MoveChoice;
+	typedef typename BasicBoard<W, H>::undo undo;
+
+	if (depth <= 0 || b.gameover()) {
+		return;
+	}
+
+	const auto state = b.hash();
+	const auto key = b.key();
+	const auto eval = b.eval();
+	const auto winner = b.winner();
+	const auto tiles = b.tile_info();
+	std::vector<MoveChoice> moves;
+
+	if (b.state == SWAP) {
+		for (auto &s : b.generate_swaps()) {
+			MoveChoice m;
+			m.swap.first = s.first;
+			m.swap.second = s.second;
+			moves.push_back(m);
+		}
+	} else {
+		for (auto &a : b.generate_actions()) {
+			MoveChoice m;
+			m.act = a;
+			moves.push_back(m);
+		}
+	}
+
+	for (auto &m : moves) {
+		const undo u = b.make_move(m);
+		BasicBoard<W, H> fresh;
+		// load_hash rejects surrendered positions
+		if (fresh.load_hash(b.hash())) {
+			EXPECT_EQ(b.eval(), fresh.eval());
+			EXPECT_EQ(b.winner(), fresh.winner());
+		}
+		check_make_unmake(b, depth - 1);
+		b.unmake(u);
+
+		ASSERT_EQ(b.hash(), state);
+		ASSERT_EQ(b.key(), key);
+		ASSERT_EQ(b.eval(), eval);
+		ASSERT_EQ(b.winner(), winner);
+		auto after = b.tile_info();
+		for (int i = 0; i < W * H; ++i) {
+			if (tiles[i].hp > 0) {
+				ASSERT_EQ(after[i].active, tiles[i].active) << "Activity differs at " << i;
+			}
+		}
+	}
+}
+
+TEST(BoardMakeUnmakeTests, RoundTrip)
+{
+	const std::string files[] = {
+		"../config/positions/default1.txt",
+		"../config/positions/analysis1.txt",
+		"test_positions/archer_bug.txt",
+		"test_positions/simple1.txt"
+	};
+
+	for (auto file_name : files) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+		check_make_unmake(b, 4);
+	}
+}
+
+TEST(BoardMakeUnmakeTests, LargerBoards)
+{
+	BasicBoard<5, 5> b5;
+	std::string file_name = "test_positions/default1_5x5.txt";
+	ASSERT_EQ(b5.load_file(file_name), true) << file_name;
+	check_make_unmake(b5, 3);
+
+	// the packed state of a 6x6 board doesn't fit in 128 bits
+	BasicBoard<6, 6> b6, loaded;
+	file_name = "test_positions/default1_6x6.txt";
+	ASSERT_EQ(b6.load_file(file_name), true) << file_name;
+	ASSERT_EQ(loaded.load_hash(b6.hash()), true);
+	EXPECT_EQ(loaded.hash(), b6.hash());
+	EXPECT_EQ(loaded.key(), b6.key());
+	check_make_unmake(b6, 3);
+}
@@ -0,0 +1,54 @@
+#include <board.h>
+#include <perft.h>
+#include <numeric>
+#include <gtest/gtest.h>
+
+
+/* Description: loads the position in file_name and checks the perft count at each depth,
+ * 		expected[i] is the count at depth i + 1.
+ */
+template <int W = BOARD_WIDTH, int H = BOARD_HEIGHT>
+static void check_perft(std::string file_name, std::vector<uint64_t> expected)
+{
+	BasicBoard<W, H> b;
+	ASSERT_EQ(b.load_file(file_name), true) << file_name;
+
+	for (int depth = 1; depth <= (int)expected.size(); ++depth) {
+		EXPECT_EQ(perft(b, depth), expected[depth - 1]) << file_name << " at depth " << depth;
+	}
+}
+
+TEST(PerftTests, Default1)
+{
+	check_perft("../config/positions/default1.txt", {13, 177, 2282, 30648, 390651});
+}
+
+TEST(PerftTests, Endgame1)
+{
+	check_perft("../config/positions/endgame1.txt", {2, 5, 5, 10, 20, 46, 46, 89, 175, 417, 417, 736});
+}
+
+TEST(PerftTests, Endgame2)
+{
+	check_perft("../config/positions/endgame2.txt", {2, 5, 5, 10, 20, 46, 46, 92, 171, 392, 392, 726});
+}
+
+TEST(PerftTests, LargerBoards)
+{
+	// the default position placed on larger boards, pieces only interact with other pieces
+	// so the counts match the 4x4 board
+	check_perft<5, 5>("test_positions/default1_5x5.txt", {13, 177, 2282, 30648});
+	check_perft<6, 6>("test_positions/default1_6x6.txt", {13, 177, 2282, 30648});
+}
+
+TEST(PerftTests, Divide)
+{
+	Board b;
+	std::string file_name = "../config/positions/analysis1.txt";
+	ASSERT_EQ(b.load_file(file_name), true);
+
+	auto counts = perft_divide(b, 4);
+	EXPECT_EQ(counts.size(), b.generate_swaps().size());
+	EXPECT_EQ(std::accumulate(counts.begin(), counts.end(), (uint64_t)0), perft(b, 4));
+	EXPECT_EQ(perft(b, 4), 676);
+}
@@ -0,0 +1,236 @@
+#include <board.h>
+#include <alphabeta.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+
+static std::string positions[] = {
+	"../config/positions/default1.txt",
+	"../config/positions/analysis1.txt",
+	"../config/positions/endgame1.txt",
+	"../config/positions/endgame2.txt"
+};
+
+/* Description: checks that the move suggested for each shipped position is legal and that
+ * 		the search leaves the board untouched.
+ */
+static void check_suggest_move(int depth, const SearchOptions &options)
+{
+	for (auto &file_name : positions) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+		const uint_fast128_t before = b.hash();
+
+		const int index = suggest_move(b, depth, options);
+		const int num_moves = b.state == SWAP ? b.generate_swaps().size() : b.generate_actions().size();
+
+		EXPECT_GE(index, 0) << file_name;
+		EXPECT_LT(index, num_moves) << file_name;
+		EXPECT_EQ(b.hash(), before) << file_name;
+	}
+}
+
+TEST(SearchTests, SingleThread)
+{
+	check_suggest_move(3, SearchOptions{});
+}
+
+TEST(SearchTests, Pruning)
+{
+	SearchOptions options;
+	for (bool reductions : {false, true}) {
+		for (bool null_move : {false, true}) {
+			options.late_move_reductions = reductions;
+			options.null_move = null_move;
+			check_suggest_move(5, options);
+		}
+	}
+}
+
+TEST(SearchTests, Limits)
+{
+	SearchOptions options;
+	options.time_limit = std::chrono::milliseconds{50};
+	for (int threads : {1, 4}) {
+		options.threads = threads;
+		const auto start = std::chrono::steady_clock::now();
+		check_suggest_move(0, options);
+		// generous bound as the positions are searched one after another on a loaded machine
+		EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{2}) << threads << " threads";
+	}
+
+	options = SearchOptions{};
+	options.node_limit = 2000;
+	check_suggest_move(0, options);
+
+	// a search stopped before it starts can't pick a move
+	std::atomic<bool> stop{true};
+	options = SearchOptions{};
+	options.stop = &stop;
+	Board b;
+	ASSERT_EQ(b.load_file(positions[0]), true);
+	EXPECT_EQ(suggest_move(b, 4, options), -1);
+}
+
+TEST(SearchTests, Pondering)
+{
+	// stopping without a search running does nothing
+	stop_pondering();
+
+	for (auto &file_name : positions) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+		const uint_fast128_t before = b.hash();
+
+		start_pondering(b, 0);
+		std::this_thread::sleep_for(std::chrono::milliseconds{20});
+		stop_pondering();
+		EXPECT_EQ(b.hash(), before) << file_name;
+	}
+	// the searches that follow reuse the entries left by pondering
+	check_suggest_move(4, SearchOptions{});
+}
+
+TEST(SearchTests, Session)
+{
+	SearchSession session;
+
+	for (auto &file_name : positions) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+
+		// play the suggested moves, the session re-roots onto each of them
+		for (int i = 0; i < 12 && !b.gameover(); ++i) {
+			const uint_fast128_t before = b.hash();
+			// a shallower search of the same position, like a hint, is continued by the
+			// deeper one and a repeated search returns the same move
+			ASSERT_GE(session.suggest_move(b, 2), 0) << file_name;
+			const int index = session.suggest_move(b, 3);
+			EXPECT_EQ(session.suggest_move(b, 3), index) << file_name;
+			ASSERT_EQ(b.hash(), before) << file_name;
+
+			MoveChoice m;
+			if (b.state == SWAP) {
+				auto swaps = b.generate_swaps();
+				ASSERT_GE(index, 0) << file_name;
+				ASSERT_LT(index, (int)swaps.size()) << file_name;
+				m.swap.first = swaps[index].first;
+				m.swap.second = swaps[index].second;
+			} else {
+				auto actions = b.generate_actions();
+				ASSERT_GE(index, 0) << file_name;
+				ASSERT_LT(index, (int)actions.size()) << file_name;
+				m.act = actions[index];
+			}
+			session.advance(m);
+			b.make_move(m);
+		}
+	}
+}
+
+TEST(SearchTests, SessionLimits)
+{
+	SearchSession session;
+	SearchOptions options;
+	options.node_limit = 2000;
+	// only a depth 1 iteration can't be stopped, it visits the root and its children
+	const uint64_t bound = options.node_limit + MAX_ACTIONS(BOARD_WIDTH, BOARD_HEIGHT) + 1;
+
+	for (auto &file_name : positions) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+
+		// the tree the session resumes from after pondering is deeper than the node limit allows
+		start_pondering(b, 0, SearchOptions{}, &session);
+		std::this_thread::sleep_for(std::chrono::milliseconds{100});
+		stop_pondering();
+
+		SearchResult result;
+		const int index = session.suggest_move(b, 0, options, &result);
+		ASSERT_GE(index, 0) << file_name;
+		EXPECT_LE(result.stats.nodes, bound) << file_name;
+
+		MoveChoice m;
+		if (b.state == SWAP) {
+			auto swaps = b.generate_swaps();
+			m.swap.first = swaps[index].first;
+			m.swap.second = swaps[index].second;
+		} else {
+			m.act = b.generate_actions()[index];
+		}
+		session.advance(m);
+		b.make_move(m);
+
+		// the re-rooted tree has no move to fall back on
+		result = SearchResult{};
+		EXPECT_GE(session.suggest_move(b, 0, options, &result), 0) << file_name;
+		EXPECT_LE(result.stats.nodes, bound) << file_name;
+	}
+}
+
+TEST(SearchTests, Stats)
+{
+	for (auto &file_name : positions) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+
+		SearchResult result;
+		const int index = suggest_move(b, 3, SearchOptions{}, &result);
+		EXPECT_EQ(result.move, index) << file_name;
+		EXPECT_GT(result.depth, 0) << file_name;
+		ASSERT_FALSE(result.stats.iterations.empty()) << file_name;
+		EXPECT_EQ(result.stats.iterations.back().depth, result.depth) << file_name;
+		EXPECT_EQ(result.stats.iterations.back().move, index) << file_name;
+		uint64_t nodes = 0;
+		for (auto &it : result.stats.iterations) {
+			nodes += it.nodes;
+		}
+		EXPECT_EQ(result.stats.nodes, nodes) << file_name;
+#ifdef FF_SEARCH_STATS
+		EXPECT_GT(result.stats.leaves, 0u) << file_name;
+		EXPECT_GT(result.stats.expanded, 0u) << file_name;
+		EXPECT_GE(result.stats.children, result.stats.expanded) << file_name;
+		EXPECT_LE(result.stats.tt_hits, result.stats.tt_probes) << file_name;
+		EXPECT_LE(result.stats.tt_cutoffs, result.stats.tt_hits) << file_name;
+#endif
+
+		const std::string json = to_json(result);
+		EXPECT_EQ(json.front(), '{') << file_name;
+		EXPECT_EQ(json.back(), '}') << file_name;
+		EXPECT_NE(json.find("\"iterations\":[{"), std::string::npos) << json;
+	}
+}
+
+TEST(SearchTests, LazySMP)
+{
+	SearchOptions options;
+	options.threads = 4;
+	// repeat the search so the helpers run into entries and arenas left by previous searches
+	for (int i = 0; i < 3; ++i) {
+		check_suggest_move(3, options);
+	}
+}
+
+TEST(SearchTests, Deterministic)
+{
+	SearchOptions options;
+	options.deterministic = true;
+	check_suggest_move(3, options);
+
+	// the suggested move must not depend on the number of threads
+	for (auto &file_name : positions) {
+		Board b;
+		ASSERT_EQ(b.load_file(file_name), true) << file_name;
+
+		options.threads = 1;
+		const int expected = suggest_move(b, 4, options);
+		for (int threads : {2, 4, 8}) {
+			options.threads = threads;
+			for (int i = 0; i < 3; ++i) {
+				EXPECT_EQ(suggest_move(b, 4, options), expected) << file_name << " with " << threads << " threads";
+			}
+		}
+		// the deterministic search ignores the limits, so depth 0 searches the default depth
+		EXPECT_EQ(suggest_move(b, 0, options), expected) << file_name;
+	}
+}